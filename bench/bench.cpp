@@ -0,0 +1,272 @@
+// Mesures de performance : primitives, intersection avec la scène, réflexion/réfraction et rendu complet
+// sur des scènes procédurales. Lancé par « make bench ».
+//
+// Options :
+//   --json FICHIER : écrit aussi les résultats en JSON, pour comparer deux versions
+//   --quick        : scènes plus petites et mesures plus courtes
+//   --filter TEXTE : ne lance que les mesures dont le nom contient TEXTE
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <memory>
+#include <functional>
+#include <cmath>
+#include <omp.h>
+
+#include "renderer.hpp"
+#include "generators.hpp"
+#include "scene_io.hpp"
+#include "sphere.hpp"
+#include "parallelepiped.hpp"
+#include "plane.hpp"
+#include "packet.hpp"
+#include "fast_math.hpp"
+
+// Résultat d'une mesure : items opérations (rayons, pixels...) en seconds secondes
+struct BenchResult {
+    std::string name;
+    std::string unit;
+    double items;
+    double seconds;
+};
+
+struct BenchSettings {
+    bool quick = false;
+    std::string filter;
+    double min_time = 0.5; // durée minimale de chaque mesure, en secondes
+};
+
+// Empêche le compilateur de supprimer les calculs dont le résultat n'est pas utilisé
+static volatile float g_sink;
+
+// Répète f (qui traite items_per_call opérations) jusqu'à dépasser la durée minimale
+static BenchResult measure(const BenchSettings& settings, const std::string& name, const std::string& unit,
+                           double items_per_call, const std::function<void()>& f) {
+    f(); // mise en route des caches
+    double items = 0.;
+    const double start = omp_get_wtime();
+    double elapsed = 0.;
+    do {
+        f();
+        items += items_per_call;
+        elapsed = omp_get_wtime() - start;
+    } while (elapsed < settings.min_time);
+    return {name, unit, items, elapsed};
+}
+
+// Directions aléatoires depuis l'origine, dans un cône d'axe -z
+static std::vector<Vec3f> random_directions(size_t count, float spread, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::vector<Vec3f> directions(count);
+    for (Vec3f& dir : directions) dir = Vec3f(unit(random)*spread, unit(random)*spread, -1.f).normalize();
+    return directions;
+}
+
+// Intersection et normale d'une primitive seule, pour des rayons qui la touchent environ une fois sur deux
+static void bench_primitive(const BenchSettings& settings, const std::string& name, const Object& object,
+                            float spread, std::vector<BenchResult>& results) {
+    const std::vector<Vec3f> directions = random_directions(4096, spread, 1);
+    const Vec3f origin(0, 0, 0);
+
+    results.push_back(measure(settings, "primitive/" + name + "/ray_intersect", "rays", directions.size(), [&]() {
+        float sum = 0.f, t;
+        for (const Vec3f& dir : directions) {
+            if (object.ray_intersect(origin, dir, t)) sum += t;
+        }
+        g_sink = sum;
+    }));
+
+    std::vector<Vec3f> points;
+    for (const Vec3f& dir : directions) {
+        float t;
+        if (object.ray_intersect(origin, dir, t)) points.push_back(origin + dir*t);
+    }
+    if (points.empty()) return;
+    results.push_back(measure(settings, "primitive/" + name + "/get_normal", "normals", points.size(), [&]() {
+        float sum = 0.f;
+        for (const Vec3f& point : points) sum += object.get_normal(point).x;
+        g_sink = sum;
+    }));
+}
+
+static void bench_shading(const BenchSettings& settings, std::vector<BenchResult>& results) {
+    const std::vector<Vec3f> directions = random_directions(4096, 1.f, 2);
+    const std::vector<Vec3f> normals = random_directions(4096, 1.f, 3);
+
+    results.push_back(measure(settings, "shading/reflect", "rays", directions.size(), [&]() {
+        float sum = 0.f;
+        for (size_t i = 0; i < directions.size(); i++) sum += reflect(directions[i], normals[i]).x;
+        g_sink = sum;
+    }));
+    results.push_back(measure(settings, "shading/refract", "rays", directions.size(), [&]() {
+        float sum = 0.f;
+        for (size_t i = 0; i < directions.size(); i++) sum += refract(directions[i], normals[i], 1.5f).x;
+        g_sink = sum;
+    }));
+
+    // Terme spéculaire du miroir (exposant 1425) : powf, puis version de l'éclairage rapide
+    std::vector<float> cosines(directions.size());
+    for (size_t i = 0; i < directions.size(); i++) cosines[i] = std::abs(directions[i]*normals[i]);
+    results.push_back(measure(settings, "shading/powf", "terms", cosines.size(), [&]() {
+        float sum = 0.f;
+        for (float x : cosines) sum += powf(x, 1425.f);
+        g_sink = sum;
+    }));
+    const SpecularPower specular(1425.f);
+    results.push_back(measure(settings, "shading/specular_power", "terms", cosines.size(), [&]() {
+        float sum = 0.f;
+        for (float x : cosines) sum += specular(x);
+        g_sink = sum;
+    }));
+}
+
+// Scène procédurale construite avec la bibliothèque de matériaux par défaut et le sol en damier
+static std::unique_ptr<Scene> make_scene(const std::function<void(Scene&)>& generate, Accelerator accelerator) {
+    std::unique_ptr<Scene> scene(new Scene());
+    add_default_materials(scene->get_materials());
+    scene->set_accelerator(accelerator);
+    add_checkerboard_floor(*scene);
+    generate(*scene);
+    scene->build();
+    return scene;
+}
+
+// Rayons primaires d'une image 256 x 192 contre toute la scène, un thread
+static void bench_scene_intersect(const BenchSettings& settings, const std::string& name, const Scene& scene,
+                                  std::vector<BenchResult>& results) {
+    const int width = 256, height = 192;
+    std::vector<Vec3f> directions;
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) directions.push_back(primary_ray_dir(i, j, width, height, std::tan(0.5)));
+    }
+    results.push_back(measure(settings, "scene_intersect/" + name, "rays", directions.size(), [&]() {
+        float sum = 0.f;
+        Hit hit;
+        for (const Vec3f& dir : directions) {
+            if (scene_intersect(Vec3f(0, 0, 0), dir, scene, hit)) sum += hit.t;
+        }
+        g_sink = sum;
+    }));
+}
+
+// Rendu complet, tous les threads ; l'image est encodée puis jetée
+static void bench_render(const BenchSettings& settings, const std::string& name, const Scene& scene,
+                         const RenderOptions& base, std::vector<BenchResult>& results) {
+    RenderOptions options = base;
+    options.width = settings.quick ? 320 : 640;
+    options.height = settings.quick ? 240 : 480;
+    options.output = "/dev/null";
+    ImageWriter writer;
+    results.push_back(measure(settings, "render/" + name, "pixels", double(options.width)*options.height, [&]() {
+        render(scene, options, writer);
+        writer.wait();
+    }));
+}
+
+static void write_json(const std::string& filename, const std::vector<BenchResult>& results) {
+    std::ofstream file(filename);
+    file << std::setprecision(6);
+    file << "{\n  \"threads\": " << omp_get_max_threads() << ",\n  \"isa\": \"" << packet_isa() << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        file << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"count\": " << (long long)r.items
+             << ", \"seconds\": " << r.seconds << ", \"ns_per_item\": " << 1e9*r.seconds/r.items
+             << ", \"items_per_second\": " << r.items/r.seconds << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchSettings settings;
+    std::string json_file;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--json" && i + 1 < argc) json_file = argv[++i];
+        else if (arg == "--quick") settings.quick = true;
+        else if (arg == "--filter" && i + 1 < argc) settings.filter = argv[++i];
+    }
+    if (settings.quick) settings.min_time = 0.1;
+    const size_t n = settings.quick ? 2000 : 20000;
+
+    // Chaque mesure est déclarée avec son nom complet pour pouvoir être filtrée avant d'être lancée
+    std::vector<BenchResult> results;
+    auto selected = [&](const std::string& name) {
+        return settings.filter.empty() || name.find(settings.filter) != std::string::npos;
+    };
+
+    if (selected("primitive/sphere")) {
+        Sphere sphere(Vec3f(0, 0, -10), 2.f, 0);
+        bench_primitive(settings, "sphere", sphere, 0.3f, results);
+    }
+    if (selected("primitive/parallelepiped")) {
+        Parallelepiped box(Vec3f(0, 0, -10), Vec3f(3, 3, 3), 0, 0.5f, 0.3f, 0.2f);
+        bench_primitive(settings, "parallelepiped", box, 0.3f, results);
+    }
+    if (selected("primitive/plane")) {
+        Plane plane(Vec3f(0, 1, 0), -4.f, 0);
+        bench_primitive(settings, "plane", plane, 1.f, results);
+    }
+    if (selected("shading")) bench_shading(settings, results);
+
+    auto spheres = [n](Scene& scene) { generate_random_spheres(scene, n, 1); };
+    auto grid = [&settings](Scene& scene) { generate_parallelepiped_grid(scene, 10, settings.quick ? 5 : 10, settings.quick ? 10 : 20, 2); };
+    auto glass = [&settings](Scene& scene) { generate_glass_scene(scene, settings.quick ? 50 : 200, 3); };
+    auto lights = [n](Scene& scene) { generate_many_lights(scene, n/10, 64, 4); };
+    auto rig = [n](Scene& scene) { generate_light_rig(scene, n/10, 2048, 6.f, 4); };
+    auto forest = [n](Scene& scene) { generate_forest(scene, n*10, 5); };
+    // Tore d'un million de triangles (20 000 avec --quick)
+    const size_t torus_segments = settings.quick ? 100 : 1000;
+    auto torus = [torus_segments](Scene& scene) { generate_torus_mesh(scene, torus_segments, torus_segments/2); };
+
+    if (selected("build/torus_mesh")) {
+        results.push_back(measure(settings, "build/torus_mesh", "triangles", double(torus_segments*torus_segments), [&]() {
+            Scene scene;
+            add_default_materials(scene.get_materials());
+            torus(scene);
+        }));
+    }
+
+    const struct { const char* name; Accelerator accelerator; } accelerators[] = {
+        {"bvh", Accelerator::BVH}, {"soa", Accelerator::Compiled}, {"linear", Accelerator::Linear}
+    };
+    for (const auto& a : accelerators) {
+        std::string name = std::string("spheres_") + std::to_string(n) + "/" + a.name;
+        if (!selected("scene_intersect/" + name)) continue;
+        // Le parcours linéaire est limité à une scène plus petite, sinon la mesure dure des minutes
+        auto generate = a.accelerator == Accelerator::Linear
+            ? std::function<void(Scene&)>([n](Scene& scene) { generate_random_spheres(scene, n/10, 1); }) : spheres;
+        if (a.accelerator == Accelerator::Linear) name = std::string("spheres_") + std::to_string(n/10) + "/linear";
+        bench_scene_intersect(settings, name, *make_scene(generate, a.accelerator), results);
+    }
+
+    RenderOptions options;
+    const struct { const char* name; std::function<void(Scene&)> generate; bool packets; int light_samples; bool tile_lists; } renders[] = {
+        {"spheres", spheres, false, 0, false}, {"spheres_packets", spheres, true, 0, false},
+        {"spheres_tile_lists", spheres, false, 0, true}, {"parallelepiped_grid", grid, false, 0, false},
+        {"glass", glass, false, 0, false}, {"many_lights", lights, false, 0, false}, {"many_lights_sampled", lights, false, 8, false},
+        {"light_rig", rig, false, 0, false}, {"light_rig_sampled", rig, false, 8, false}, {"forest", forest, false, 0, false},
+        {"torus_mesh", torus, false, 0, false}
+    };
+    for (const auto& r : renders) {
+        if (!selected(std::string("render/") + r.name)) continue;
+        options.packets = r.packets;
+        options.light_samples = r.light_samples;
+        options.tile_lists = r.tile_lists;
+        bench_render(settings, r.name, *make_scene(r.generate, Accelerator::BVH), options, results);
+    }
+
+    std::cout << std::left << std::setw(44) << "mesure" << std::right << std::setw(14) << "ns/élément"
+              << std::setw(18) << "éléments/s" << "  unité" << std::endl;
+    for (const BenchResult& r : results) {
+        std::cout << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << 1e9*r.seconds/r.items << std::setw(18) << std::setprecision(0) << r.items/r.seconds
+                  << "  " << r.unit << std::endl;
+    }
+    if (!json_file.empty()) write_json(json_file, results);
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Écart de l'éclairage rapide (--fast-shading) : chaque scène de référence est rendue avec l'éclairage
+// exact puis avec les noyaux approchés de fast_math.hpp, et les deux images sont comparées pixel par
+// pixel. Lancé par « make shading-error ».
+//
+// Usage : oort_shading_error [options] [SCÈNE...]
+//   SCÈNE          : fichiers de scène rendus en plus des scènes procédurales
+//   --quick        : scènes procédurales et images plus petites
+//   --max-error N  : budget d'erreur en niveaux de l'image 8 bits ; code de retour 1 s'il est dépassé
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <omp.h>
+
+#include "renderer.hpp"
+#include "generators.hpp"
+#include "scene_io.hpp"
+#include "image_output.hpp"
+#include "tiles.hpp"
+#include "number_parsing.hpp"
+
+// Écart entre l'image exacte et l'image rapide d'une scène
+struct ShadingError {
+    float max_difference = 0.f;   // plus grand écart d'une composante, couleurs ramenées dans [0, 1]
+    int max_levels = 0;           // plus grand écart d'une composante dans l'image 8 bits
+    size_t pixels = 0;            // pixels dont l'image 8 bits change
+    double exact_seconds = 0.;
+    double fast_seconds = 0.;
+};
+
+// Rendu en une passe de toute l'image ; rend la durée du rendu
+static double render_image(const Scene& scene, const RenderOptions& options, std::vector<Vec3f>& framebuffer) {
+    TileScheduler scheduler(options.width, options.height, options.tile_size, options.tile_order);
+    std::vector<Tile> tiles;
+    for (size_t t = 0; t < scheduler.size(); t++) tiles.push_back(scheduler.get(t));
+    framebuffer.assign(static_cast<size_t>(options.width)*options.height, Vec3f(0, 0, 0));
+    const double start = omp_get_wtime();
+    render_tiles(scene, options, tiles, framebuffer);
+    return omp_get_wtime() - start;
+}
+
+static ShadingError measure_error(const Scene& scene, RenderOptions options) {
+    ShadingError error;
+    std::vector<Vec3f> exact, fast;
+    options.fast_shading = false;
+    error.exact_seconds = render_image(scene, options, exact);
+    options.fast_shading = true;
+    error.fast_seconds = render_image(scene, options, fast);
+
+    const size_t count = 3*exact.size();
+    std::vector<uint8_t> exact_bytes(count), fast_bytes(count);
+    quantize_rgb8(reinterpret_cast<const float*>(exact.data()), count, exact_bytes.data());
+    quantize_rgb8(reinterpret_cast<const float*>(fast.data()), count, fast_bytes.data());
+    for (size_t p = 0; p < exact.size(); p++) {
+        bool changed = false;
+        for (size_t c = 0; c < 3; c++) {
+            const float a = std::max(0.f, std::min(1.f, exact[p][c]));
+            const float b = std::max(0.f, std::min(1.f, fast[p][c]));
+            error.max_difference = std::max(error.max_difference, std::abs(a - b));
+            const int levels = std::abs(int(exact_bytes[3*p + c]) - int(fast_bytes[3*p + c]));
+            error.max_levels = std::max(error.max_levels, levels);
+            changed = changed || levels != 0;
+        }
+        if (changed) error.pixels++;
+    }
+    return error;
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    int max_error = -1;
+    std::vector<std::string> scene_files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--quick") quick = true;
+        else if (arg == "--max-error" && i + 1 < argc) {
+            if (!parse_number(argv[++i], max_error, 0)) {
+                std::cerr << "Erreur : valeur invalide pour --max-error : " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else scene_files.push_back(arg);
+    }
+    const size_t n = quick ? 2000 : 20000;
+
+    // Scènes de référence : les scènes procédurales des mesures de performance, puis les fichiers donnés
+    struct Reference {
+        std::string name;
+        std::function<bool(Scene&)> load;
+        int light_samples;
+    };
+    std::vector<Reference> references = {
+        {"spheres", [n](Scene& scene) { generate_random_spheres(scene, n, 1); return true; }, 0},
+        {"glass", [quick](Scene& scene) { generate_glass_scene(scene, quick ? 50 : 200, 3); return true; }, 0},
+        {"many_lights", [n](Scene& scene) { generate_many_lights(scene, n/10, 64, 4); return true; }, 0},
+        {"light_rig_sampled", [n](Scene& scene) { generate_light_rig(scene, n/10, 2048, 6.f, 4); return true; }, 8},
+        {"forest", [n](Scene& scene) { generate_forest(scene, n*10, 5); return true; }, 0},
+    };
+    for (const std::string& file : scene_files) {
+        references.push_back({file, [file](Scene& scene) { return load_scene(file, scene); }, 0});
+    }
+
+    RenderOptions options;
+    options.width = quick ? 320 : 640;
+    options.height = quick ? 240 : 480;
+    const struct { const char* name; ShadingModel model; } models[] = {
+        {"phong", ShadingModel::Phong}, {"blinn-phong", ShadingModel::BlinnPhong}, {"none", ShadingModel::None}
+    };
+
+    std::cout << std::left << std::setw(44) << "scène" << std::right << std::setw(12) << "écart" << std::setw(9) << "niveaux"
+              << std::setw(10) << "pixels" << std::setw(11) << "exact (s)" << std::setw(12) << "rapide (s)" << std::endl;
+    int worst = 0;
+    for (const Reference& reference : references) {
+        Scene scene;
+        add_default_materials(scene.get_materials());
+        add_checkerboard_floor(scene);
+        if (!reference.load(scene)) return 1;
+        scene.build();
+        options.light_samples = reference.light_samples;
+        for (const auto& m : models) {
+            options.shading = m.model;
+            const ShadingError error = measure_error(scene, options);
+            worst = std::max(worst, error.max_levels);
+            std::cout << std::left << std::setw(44) << reference.name + " / " + m.name << std::right << std::scientific
+                      << std::setprecision(2) << std::setw(12) << error.max_difference << std::setw(9) << error.max_levels
+                      << std::setw(10) << error.pixels << std::fixed << std::setprecision(3) << std::setw(11)
+                      << error.exact_seconds << std::setw(12) << error.fast_seconds << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+    }
+    std::cout << "Écart maximal : " << worst << " niveau(x) sur 255" << std::endl;
+    if (max_error >= 0 && worst > max_error) {
+        std::cerr << "Erreur : l'écart dépasse le budget de " << max_error << " niveau(x)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
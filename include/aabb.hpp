@@ -0,0 +1,66 @@
+#ifndef __AABB_HPP__
+#define __AABB_HPP__
+#include <limits>
+#include <algorithm>
+#include "vectors.hpp"
+
+// Boîte englobante alignée sur les axes (Axis-Aligned Bounding Box)
+class AABB {
+public:
+    // Par défaut la boîte est vide : min = +inf, max = -inf
+    AABB() : m_min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+             m_max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()) {}
+    AABB(const Vec3f& min, const Vec3f& max) : m_min(min), m_max(max) {}
+
+    // Agrandit la boîte pour contenir un point ou une autre boîte
+    void expand(const Vec3f& p) {
+        m_min = Vec3f(std::min(m_min.x, p.x), std::min(m_min.y, p.y), std::min(m_min.z, p.z));
+        m_max = Vec3f(std::max(m_max.x, p.x), std::max(m_max.y, p.y), std::max(m_max.z, p.z));
+    }
+    void expand(const AABB& b) {
+        expand(b.m_min);
+        expand(b.m_max);
+    }
+
+    // Élargit la boîte d'une marge dans toutes les directions
+    void pad(float margin) {
+        m_min = m_min - Vec3f(margin, margin, margin);
+        m_max = m_max + Vec3f(margin, margin, margin);
+    }
+
+    Vec3f get_min() const { return m_min; }
+    Vec3f get_max() const { return m_max; }
+    Vec3f get_center() const { return (m_min + m_max) * 0.5f; }
+    Vec3f get_extent() const { return m_max - m_min; }
+
+    bool is_empty() const { return m_min.x > m_max.x || m_min.y > m_max.y || m_min.z > m_max.z; }
+    bool contains(const Vec3f& p) const {
+        return p.x >= m_min.x && p.y >= m_min.y && p.z >= m_min.z && p.x <= m_max.x && p.y <= m_max.y && p.z <= m_max.z;
+    }
+
+    // Aire de la surface de la boîte, utilisée par l'heuristique SAH
+    float surface_area() const {
+        if (is_empty()) return 0.f;
+        Vec3f e = get_extent();
+        return 2.f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // Intersection rayon/boîte par la méthode des slabs. inv_dir contient 1/dir composante par composante.
+    // En cas de succès t_entry reçoit la distance d'entrée dans la boîte, restreinte à [tmin, tmax]
+    bool ray_intersect(const Vec3f& orig, const Vec3f& inv_dir, float tmin, float tmax, float& t_entry) const {
+        float tx1 = (m_min.x - orig.x) * inv_dir.x, tx2 = (m_max.x - orig.x) * inv_dir.x;
+        float ty1 = (m_min.y - orig.y) * inv_dir.y, ty2 = (m_max.y - orig.y) * inv_dir.y;
+        float tz1 = (m_min.z - orig.z) * inv_dir.z, tz2 = (m_max.z - orig.z) * inv_dir.z;
+        float t0 = std::max(tmin, std::max(std::min(tx1, tx2), std::max(std::min(ty1, ty2), std::min(tz1, tz2))));
+        float t1 = std::min(tmax, std::min(std::max(tx1, tx2), std::min(std::max(ty1, ty2), std::max(tz1, tz2))));
+        t_entry = t0;
+        return t0 <= t1;
+    }
+
+private:
+    Vec3f m_min;
+    Vec3f m_max;
+};
+
+
+#endif
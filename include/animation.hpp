@@ -0,0 +1,139 @@
+#ifndef __ANIMATION_HPP__
+#define __ANIMATION_HPP__
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "scene.hpp"
+#include "vectors.hpp"
+
+// Animation d'une scène : trajectoires d'objets et de lumières évaluées image par image (voir load_animation).
+// Un objet ou une lumière est désigné par son numéro dans le fichier de scène, en partant de 0 ;
+// objets et lumières sont numérotés séparément.
+
+enum class AnimationTarget { Object, Light };
+
+struct Keyframe {
+    int frame;
+    Vec3f position;
+};
+
+struct AnimationTrack {
+    AnimationTarget target;
+    size_t index;
+    std::vector<Keyframe> keys; // triées par image ; entre deux clés la position est interpolée linéairement
+    bool orbit;                 // rotation autour de l'axe vertical passant par orbit_center
+    Vec3f orbit_center;
+    float turns;                // nombre de tours sur l'ensemble de la séquence
+};
+
+class Animation {
+public:
+    Animation() : m_first_object(0) {}
+
+    void add_key(AnimationTarget target, size_t index, int frame, const Vec3f& position) {
+        AnimationTrack& track = get_track(target, index);
+        auto it = std::upper_bound(track.keys.begin(), track.keys.end(), frame,
+                                   [](int f, const Keyframe& key) { return f < key.frame; });
+        track.keys.insert(it, {frame, position});
+    }
+
+    void add_orbit(AnimationTarget target, size_t index, const Vec3f& center, float turns) {
+        AnimationTrack& track = get_track(target, index);
+        track.orbit = true;
+        track.orbit_center = center;
+        track.turns = turns;
+    }
+
+    bool empty() const { return m_tracks.empty(); }
+
+    // Nombre d'images couvert par les clés (dernière clé + 1), 0 sans clé
+    int get_keyed_frame_count() const {
+        int count = 0;
+        for (const AnimationTrack& track : m_tracks) {
+            if (!track.keys.empty()) count = std::max(count, track.keys.back().frame + 1);
+        }
+        return count;
+    }
+
+    // Associe l'animation à une scène dont les objets du fichier commencent à l'indice first_object
+    // (les objets ajoutés avant, comme le sol, ne sont pas numérotés). Les positions d'origine servent
+    // aux trajectoires sans clé. Faux si un numéro ne correspond à aucun objet ou lumière.
+    bool bind(const Scene& scene, size_t first_object) {
+        m_first_object = first_object;
+        m_rest.clear();
+        for (const AnimationTrack& track : m_tracks) {
+            const bool object = track.target == AnimationTarget::Object;
+            const size_t count = object ? scene.get_objects().size() - first_object : scene.get_lights().size();
+            if (track.index >= count) {
+                std::cerr << "Erreur : l'animation désigne " << (object ? "l'objet " : "la lumière ") << track.index
+                          << " mais la scène n'en a que " << count << std::endl;
+                return false;
+            }
+            m_rest.push_back(object ? scene.get_objects()[first_object + track.index]->get_position()
+                                    : scene.get_lights()[track.index].position);
+        }
+        return true;
+    }
+
+    // Place les objets et lumières animés à leur position de l'image frame (sur frame_count).
+    // Seuls les objets dont la position change sont déplacés ; Scene::refit() met ensuite à jour
+    // la structure d'accélération pour eux seuls.
+    void apply(Scene& scene, int frame, int frame_count) const {
+        for (size_t t = 0; t < m_tracks.size(); t++) {
+            const AnimationTrack& track = m_tracks[t];
+            const Vec3f position = position_at(track, m_rest[t], frame, frame_count);
+            if (track.target == AnimationTarget::Light) {
+                scene.set_light_position(track.index, position);
+                continue;
+            }
+            const size_t index = m_first_object + track.index;
+            const Vec3f current = scene.get_objects()[index]->get_position();
+            if (current.x != position.x || current.y != position.y || current.z != position.z) {
+                scene.set_object_position(index, position);
+            }
+        }
+    }
+
+private:
+    std::vector<AnimationTrack> m_tracks;
+    std::vector<Vec3f> m_rest; // position d'origine de la cible de chaque trajectoire
+    size_t m_first_object;
+
+    AnimationTrack& get_track(AnimationTarget target, size_t index) {
+        for (AnimationTrack& track : m_tracks) {
+            if (track.target == target && track.index == index) return track;
+        }
+        m_tracks.push_back({target, index, {}, false, Vec3f(0, 0, 0), 0.f});
+        return m_tracks.back();
+    }
+
+    static Vec3f position_at(const AnimationTrack& track, const Vec3f& rest, int frame, int frame_count) {
+        Vec3f position = rest;
+        if (!track.keys.empty()) {
+            // Avant la première clé et après la dernière, la position reste celle de la clé
+            auto next = std::upper_bound(track.keys.begin(), track.keys.end(), frame,
+                                         [](int f, const Keyframe& key) { return f < key.frame; });
+            if (next == track.keys.begin()) {
+                position = next->position;
+            } else if (next == track.keys.end()) {
+                position = track.keys.back().position;
+            } else {
+                const Keyframe& previous = *(next - 1);
+                float s = float(frame - previous.frame)/(next->frame - previous.frame);
+                position = previous.position*(1.f - s) + next->position*s;
+            }
+        }
+        if (track.orbit && frame_count > 0) {
+            // Le cercle est parcouru à vitesse constante ; la dernière image précède le retour au départ
+            float angle = 2.f*float(M_PI)*track.turns*frame/frame_count;
+            float c = std::cos(angle), s = std::sin(angle);
+            Vec3f r = position - track.orbit_center;
+            position = track.orbit_center + Vec3f(c*r.x + s*r.z, r.y, -s*r.x + c*r.z);
+        }
+        return position;
+    }
+};
+
+
+#endif
@@ -0,0 +1,370 @@
+#ifndef __BVH_HPP__
+#define __BVH_HPP__
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include "aabb.hpp"
+#include "packet.hpp"
+#include "stats.hpp"
+#include "vectors.hpp"
+
+// Noeud de la hiérarchie, stocké dans un tableau à plat en ordre préfixe :
+// le fils gauche d'un noeud interne est le noeud suivant, le fils droit est à l'indice offset
+struct BVHNode {
+    AABB bounds;
+    uint32_t offset;   // feuille : première primitive ; noeud interne : indice du fils droit
+    uint32_t count;    // nombre de primitives de la feuille, 0 pour un noeud interne
+};
+
+// Hiérarchie de volumes englobants construite avec l'heuristique de surface (SAH).
+// La BVH ne connaît que les boîtes des primitives : le test d'intersection des primitives
+// est fourni par l'appelant lors du parcours.
+class BVH {
+public:
+    BVH() : m_total_area(0.) {}
+
+    // Construit la hiérarchie à partir des boîtes englobantes des primitives
+    void build(const std::vector<AABB>& bounds) {
+        m_nodes.clear();
+        m_parents.clear();
+        m_leaf_of_slot.clear();
+        m_total_area = 0.;
+        m_indices.resize(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) m_indices[i] = static_cast<uint32_t>(i);
+        if (bounds.empty()) return;
+
+        std::vector<Vec3f> centroids(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) centroids[i] = bounds[i].get_center();
+
+        m_nodes.reserve(2 * bounds.size());
+        build_node(bounds, centroids, 0, static_cast<uint32_t>(bounds.size()), 0);
+        // La réserve couvre le pire cas (une primitive par feuille) ; le surplus est rendu
+        m_nodes.shrink_to_fit();
+
+        // Parent de chaque noeud et feuille de chaque primitive, pour remettre à jour les boîtes
+        // des seuls noeuds concernés quand des primitives bougent (refit)
+        m_parents.assign(m_nodes.size(), 0);
+        m_leaf_of_slot.assign(bounds.size(), 0);
+        for (uint32_t n = 0; n < m_nodes.size(); n++) {
+            m_total_area += m_nodes[n].bounds.surface_area();
+            if (m_nodes[n].count > 0) {
+                for (uint32_t i = m_nodes[n].offset; i < m_nodes[n].offset + m_nodes[n].count; i++) m_leaf_of_slot[i] = n;
+            } else {
+                m_parents[n + 1] = n;
+                m_parents[m_nodes[n].offset] = n;
+            }
+        }
+    }
+
+    // Recalcule les boîtes après le déplacement des primitives rangées aux positions slots des feuilles,
+    // sans changer la forme de l'arbre. bounds(slot) donne la nouvelle boîte de la primitive.
+    // Seuls les feuilles concernées et leurs ancêtres sont recalculés.
+    template <typename Bounds>
+    void refit(const std::vector<uint32_t>& slots, Bounds&& bounds) {
+        std::vector<uint32_t> dirty;
+        m_dirty.resize(m_nodes.size(), 0);
+        for (uint32_t slot : slots) {
+            uint32_t n = m_leaf_of_slot[slot];
+            while (!m_dirty[n]) {
+                m_dirty[n] = 1;
+                dirty.push_back(n);
+                if (n == 0) break;
+                n = m_parents[n];
+            }
+        }
+        // En ordre préfixe les fils suivent leur parent : en remontant les indices, les fils sont à jour
+        // avant leur parent
+        std::sort(dirty.begin(), dirty.end(), std::greater<uint32_t>());
+        for (uint32_t n : dirty) {
+            BVHNode& node = m_nodes[n];
+            AABB box;
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) box.expand(bounds(i));
+            } else {
+                box.expand(m_nodes[n + 1].bounds);
+                box.expand(m_nodes[node.offset].bounds);
+            }
+            m_total_area += box.surface_area() - node.bounds.surface_area();
+            node.bounds = box;
+            m_dirty[n] = 0;
+        }
+    }
+
+    // Somme des aires des boîtes de tous les noeuds, proportionnelle au coût SAH du parcours :
+    // sa croissance au fil des refits indique que l'arbre se dégrade
+    double total_area() const { return m_total_area; }
+
+    bool empty() const { return m_nodes.empty(); }
+    size_t node_count() const { return m_nodes.size(); }
+
+    // Mémoire occupée par l'arbre et ses tables, en octets
+    size_t memory_usage() const {
+        return m_nodes.capacity()*sizeof(BVHNode) + (m_indices.capacity() + m_parents.capacity() +
+               m_leaf_of_slot.capacity())*sizeof(uint32_t) + m_dirty.capacity();
+    }
+
+    // Indice (dans le tableau passé à build) de la primitive rangée à la position slot des feuilles
+    uint32_t primitive_index(size_t slot) const { return m_indices[slot]; }
+    const std::vector<uint32_t>& primitive_indices() const { return m_indices; }
+
+    // Parcours pour le point d'intersection le plus proche. intersect(slot, tmin, tmax) teste la primitive
+    // rangée à la position slot et réduit tmax si elle est touchée plus près.
+    template <typename Intersect>
+    void intersect(const Vec3f& orig, const Vec3f& dir, float tmin, float& tmax, Intersect&& intersect_primitive) const {
+        if (m_nodes.empty()) return;
+        const Vec3f inv_dir(1.f / dir.x, 1.f / dir.y, 1.f / dir.z);
+
+        uint32_t stack[STACK_SIZE];
+        size_t stack_size = 0;
+        uint32_t node_index = 0;
+        float t_entry;
+        OORT_STAT(BoxTests);
+        if (!m_nodes[0].bounds.ray_intersect(orig, inv_dir, tmin, tmax, t_entry)) return;
+
+        while (true) {
+            const BVHNode& node = m_nodes[node_index];
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                    intersect_primitive(i, tmin, tmax);
+                }
+            } else {
+                // On visite d'abord le fils le plus proche pour réduire tmax au plus tôt
+                uint32_t left = node_index + 1, right = node.offset;
+                float t_left, t_right;
+                OORT_STAT_ADD(BoxTests, 2);
+                bool hit_left = m_nodes[left].bounds.ray_intersect(orig, inv_dir, tmin, tmax, t_left);
+                bool hit_right = m_nodes[right].bounds.ray_intersect(orig, inv_dir, tmin, tmax, t_right);
+                if (hit_left && hit_right) {
+                    if (t_right < t_left) std::swap(left, right);
+                    stack[stack_size++] = right;
+                    node_index = left;
+                    continue;
+                } else if (hit_left) {
+                    node_index = left;
+                    continue;
+                } else if (hit_right) {
+                    node_index = right;
+                    continue;
+                }
+            }
+            if (stack_size == 0) return;
+            node_index = stack[--stack_size];
+        }
+    }
+
+    // Parcours pour un test d'occultation : occluded(slot, tmin, tmax) renvoie vrai si la primitive rangée
+    // à la position slot coupe le rayon dans [tmin, tmax). On s'arrête au premier obstacle trouvé.
+    template <typename Occluded>
+    bool occluded(const Vec3f& orig, const Vec3f& dir, float tmin, float tmax, Occluded&& occluded_primitive) const {
+        if (m_nodes.empty()) return false;
+        const Vec3f inv_dir(1.f / dir.x, 1.f / dir.y, 1.f / dir.z);
+
+        uint32_t stack[STACK_SIZE];
+        size_t stack_size = 0;
+        stack[stack_size++] = 0;
+        float t_entry;
+
+        while (stack_size > 0) {
+            uint32_t node_index = stack[--stack_size];
+            const BVHNode& node = m_nodes[node_index];
+            OORT_STAT(BoxTests);
+            if (!node.bounds.ray_intersect(orig, inv_dir, tmin, tmax, t_entry)) continue;
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                    if (occluded_primitive(i, tmin, tmax)) return true;
+                }
+            } else {
+                stack[stack_size++] = node.offset;
+                stack[stack_size++] = node_index + 1;
+            }
+        }
+        return false;
+    }
+
+    // Parcours des feuilles dont la boîte contient le point : visit(slot) est appelé pour chaque primitive
+    // qui y est rangée, à l'appelant de vérifier qu'elle contient vraiment le point
+    template <typename Visit>
+    void query_point(const Vec3f& point, Visit&& visit) const {
+        if (m_nodes.empty()) return;
+        uint32_t stack[STACK_SIZE];
+        size_t stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0) {
+            const uint32_t node_index = stack[--stack_size];
+            const BVHNode& node = m_nodes[node_index];
+            OORT_STAT(BoxTests);
+            if (!node.bounds.contains(point)) continue;
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) visit(i);
+            } else {
+                stack[stack_size++] = node.offset;
+                stack[stack_size++] = node_index + 1;
+            }
+        }
+    }
+
+    // Parcours pour un paquet de rayons : un noeud est visité dès qu'un des rayons du paquet le traverse.
+    // intersect(slot) teste la primitive rangée à la position slot contre tout le paquet.
+    template <typename Intersect>
+    void intersect_packet(RayPacket& packet, Intersect&& intersect_primitive) const {
+        if (m_nodes.empty()) return;
+        float t_entry;
+        OORT_STAT_ADD(BoxTests, PACKET_SIZE);
+        if (!packet_bounds_test(packet, m_nodes[0].bounds, t_entry)) return;
+
+        uint32_t stack[STACK_SIZE];
+        size_t stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0) {
+            uint32_t node_index = stack[--stack_size];
+            const BVHNode& node = m_nodes[node_index];
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                    intersect_primitive(i);
+                }
+                continue;
+            }
+            // Le fils le plus proche est empilé en dernier pour être visité en premier
+            uint32_t left = node_index + 1, right = node.offset;
+            float t_left, t_right;
+            OORT_STAT_ADD(BoxTests, 2*PACKET_SIZE);
+            bool hit_left = packet_bounds_test(packet, m_nodes[left].bounds, t_left);
+            bool hit_right = packet_bounds_test(packet, m_nodes[right].bounds, t_right);
+            if (hit_left && hit_right && t_right < t_left) {
+                std::swap(left, right);
+                std::swap(hit_left, hit_right);
+            }
+            if (hit_right) stack[stack_size++] = right;
+            if (hit_left) stack[stack_size++] = left;
+        }
+    }
+
+private:
+    static const size_t STACK_SIZE = 64;
+    static const int SAH_BINS = 16;
+    static const uint32_t MAX_LEAF_SIZE = 8;
+    static const size_t MAX_SAH_DEPTH = 32;
+    // Coûts relatifs d'un pas de parcours et d'un test de primitive
+    static constexpr float TRAVERSAL_COST = 1.f;
+    static constexpr float INTERSECTION_COST = 1.f;
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_indices;
+    std::vector<uint32_t> m_parents;      // parent de chaque noeud (0 pour la racine)
+    std::vector<uint32_t> m_leaf_of_slot; // feuille qui contient chaque primitive
+    std::vector<char> m_dirty;            // marques temporaires du refit
+    double m_total_area;
+
+    // Construit récursivement le noeud couvrant les primitives m_indices[begin, end)
+    void build_node(const std::vector<AABB>& bounds, const std::vector<Vec3f>& centroids, uint32_t begin, uint32_t end, size_t depth) {
+        uint32_t node_index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(BVHNode());
+
+        AABB node_bounds, centroid_bounds;
+        for (uint32_t i = begin; i < end; i++) {
+            node_bounds.expand(bounds[m_indices[i]]);
+            centroid_bounds.expand(centroids[m_indices[i]]);
+        }
+        m_nodes[node_index].bounds = node_bounds;
+
+        uint32_t count = end - begin;
+        if (count == 1) {
+            make_leaf(node_index, begin, count);
+            return;
+        }
+
+        // Recherche du meilleur plan de coupe par classement des centres dans des intervalles
+        int best_axis = -1, best_split = 0;
+        float best_cost = std::numeric_limits<float>::max();
+        Vec3f cmin = centroid_bounds.get_min(), cext = centroid_bounds.get_extent();
+        for (int axis = 0; axis < 3; axis++) {
+            if (cext[axis] <= 0.f) continue;
+            AABB bin_bounds[SAH_BINS];
+            uint32_t bin_count[SAH_BINS] = {0};
+            for (uint32_t i = begin; i < end; i++) {
+                int b = bin_of(centroids[m_indices[i]][axis], cmin[axis], cext[axis]);
+                bin_count[b]++;
+                bin_bounds[b].expand(bounds[m_indices[i]]);
+            }
+            // Balayage de droite à gauche puis de gauche à droite pour évaluer chaque coupe
+            float right_area[SAH_BINS];
+            uint32_t right_count[SAH_BINS];
+            AABB acc;
+            uint32_t n = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                acc.expand(bin_bounds[b]);
+                n += bin_count[b];
+                right_area[b] = acc.surface_area();
+                right_count[b] = n;
+            }
+            acc = AABB();
+            n = 0;
+            for (int b = 0; b < SAH_BINS - 1; b++) {
+                acc.expand(bin_bounds[b]);
+                n += bin_count[b];
+                if (n == 0 || right_count[b + 1] == 0) continue;
+                float cost = acc.surface_area() * n + right_area[b + 1] * right_count[b + 1];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b;
+                }
+            }
+        }
+
+        float leaf_cost = INTERSECTION_COST * count;
+        float parent_area = node_bounds.surface_area();
+        float split_cost = parent_area > 0.f ? TRAVERSAL_COST + INTERSECTION_COST * best_cost / parent_area
+                                             : std::numeric_limits<float>::max();
+
+        uint32_t middle;
+        if (depth >= MAX_SAH_DEPTH && count > MAX_LEAF_SIZE) {
+            // Arbre trop profond : coupe à la médiane sur l'axe le plus étendu pour borner la pile de parcours
+            int axis = cext.x >= cext.y && cext.x >= cext.z ? 0 : (cext.y >= cext.z ? 1 : 2);
+            middle = begin + count / 2;
+            std::nth_element(m_indices.begin() + begin, m_indices.begin() + middle, m_indices.begin() + end,
+                             [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        } else if (best_axis >= 0 && (split_cost < leaf_cost || count > MAX_LEAF_SIZE)) {
+            float axis_min = cmin[best_axis], axis_extent = cext[best_axis];
+            uint32_t* first = m_indices.data() + begin;
+            uint32_t* last = m_indices.data() + end;
+            middle = static_cast<uint32_t>(std::partition(first, last, [&](uint32_t p) {
+                return bin_of(centroids[p][best_axis], axis_min, axis_extent) <= best_split;
+            }) - m_indices.data());
+        } else if (count > MAX_LEAF_SIZE) {
+            // Centres confondus : on coupe simplement la liste en deux
+            middle = begin + count / 2;
+        } else {
+            make_leaf(node_index, begin, count);
+            return;
+        }
+
+        build_node(bounds, centroids, begin, middle, depth + 1);
+        m_nodes[node_index].offset = static_cast<uint32_t>(m_nodes.size());
+        m_nodes[node_index].count = 0;
+        build_node(bounds, centroids, middle, end, depth + 1);
+    }
+
+    void make_leaf(uint32_t node_index, uint32_t begin, uint32_t count) {
+        m_nodes[node_index].offset = begin;
+        m_nodes[node_index].count = count;
+    }
+
+    static bool packet_bounds_test(const RayPacket& packet, const AABB& bounds, float& t_entry) {
+        const Vec3f min = bounds.get_min(), max = bounds.get_max();
+        const float box_min[3] = {min.x, min.y, min.z};
+        const float box_max[3] = {max.x, max.y, max.z};
+        return packet_intersect_aabb(packet, box_min, box_max, t_entry);
+    }
+
+    static int bin_of(float c, float axis_min, float axis_extent) {
+        int b = static_cast<int>(SAH_BINS * (c - axis_min) / axis_extent);
+        return std::min(std::max(b, 0), SAH_BINS - 1);
+    }
+};
+
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __COMPILED_SCENE_HPP__
+#define __COMPILED_SCENE_HPP__
+#include <vector>
+#include <cstdint>
+#include "object.hpp"
+#include "packet.hpp"
+#include "vectors.hpp"
+
+// Représentation compilée de la scène : les primitives sont regroupées par type dans des tableaux
+// contigus (une composante par tableau). L'intersection parcourt chaque tableau avec un noyau vectoriel
+// qui teste un rayon contre plusieurs primitives à la fois, sans appel virtuel.
+// La hiérarchie Object reste l'interface de description de la scène ; elle est compilée par Scene::build().
+class CompiledScene {
+public:
+    CompiledScene() {}
+
+    // Range chaque objet dans le tableau de son type. Les types inconnus sont gardés tels quels
+    // et testés par appel virtuel.
+    void compile(const std::vector<Object*>& objects);
+
+    // Recopie la position des objets déplacés (indices dans objects) depuis la compilation
+    void update(const std::vector<Object*>& objects, const std::vector<uint32_t>& moved);
+
+    // Intersection la plus proche dans [t_min, t_max). Si une primitive est touchée plus près,
+    // t_max reçoit sa distance et object son indice dans la scène.
+    bool intersect(const Vec3f& orig, const Vec3f& dir, float t_min, float& t_max, uint32_t& object) const;
+
+    // Vrai dès qu'une primitive coupe le rayon dans [t_min, t_max)
+    bool occluded(const Vec3f& orig, const Vec3f& dir, float t_min, float t_max) const;
+
+    // Intersection la plus proche pour chaque rayon du paquet
+    void intersect_packet(RayPacket& packet) const;
+
+    size_t sphere_count() const { return m_spheres.id.size(); }
+    size_t parallelepiped_count() const { return m_parallelepipeds.id.size(); }
+    size_t plane_count() const { return m_planes.id.size(); }
+
+private:
+    struct SphereArrays {
+        std::vector<float> cx, cy, cz, radius;
+        std::vector<uint32_t> id;
+    };
+    struct ParallelepipedArrays {
+        std::vector<float> px, py, pz;   // centres
+        std::vector<float> axis[9];      // axes locaux x, y et z, trois composantes chacun
+        std::vector<float> hx, hy, hz;   // demi-dimensions
+        std::vector<uint32_t> id;
+    };
+    struct PlaneArrays {
+        std::vector<float> nx, ny, nz, distance;
+        std::vector<uint32_t> id;
+    };
+
+    SphereArrays m_spheres;
+    ParallelepipedArrays m_parallelepipeds;
+    PlaneArrays m_planes;
+    std::vector<const Object*> m_others;
+    std::vector<uint32_t> m_other_ids;
+    std::vector<uint32_t> m_slots; // position de chaque objet dans le tableau de son type
+};
+
+
+#endif
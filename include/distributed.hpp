@@ -0,0 +1,46 @@
+#ifndef __DISTRIBUTED_HPP__
+#define __DISTRIBUTED_HPP__
+#include <cstdint>
+#include "renderer.hpp"
+
+// Rendu réparti entre plusieurs processus (voir distributed.cpp). Le coordinateur découpe l'image en tuiles
+// et les confie à des processus de rendu qui lui renvoient les pixels ; il assemble l'image et redistribue
+// les tuiles d'un processus qui s'arrête en cours de route.
+//
+// Protocole : chaque message est un en-tête MessageHeader suivi de size octets. Il ne suppose qu'un flux
+// d'octets ordonné entre le coordinateur et chaque processus de rendu : une paire de sockets Unix sur une
+// même machine, une connexion TCP pour des machines distantes. Les nombres sont dans l'ordre des octets
+// de la machine.
+
+const uint32_t TILE_PROTOCOL_VERSION = 1;
+
+enum class MessageType : uint32_t {
+    Hello = 1,  // processus de rendu -> coordinateur : prêt, la scène est chargée (uint32_t version)
+    Tile = 2,   // coordinateur -> processus de rendu : tuile à rendre (TileRequest)
+    Result = 3, // processus de rendu -> coordinateur : TileResult suivi des pixels de la tuile, ligne par ligne
+    Quit = 4    // coordinateur -> processus de rendu : fin du travail, sans contenu
+};
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t size; // taille du contenu en octets
+};
+
+struct TileRequest {
+    uint32_t tile;   // numéro de la tuile, renvoyé avec le résultat
+    int32_t x0, y0;  // rectangle [x0, x1) x [y0, y1)
+    int32_t x1, y1;
+};
+
+struct TileResult {
+    uint32_t tile;
+    uint32_t pixel_count; // suivi de pixel_count x 3 flottants (rouge, vert, bleu)
+};
+
+// Rend l'image avec options.workers processus créés par fork : ils partagent la scène déjà construite
+// du coordinateur et rendent chacun une tuile à la fois sur un seul thread. Faux si l'image n'a pas pu
+// être terminée (tuile qui a fait échouer plusieurs processus, processus impossibles à créer).
+bool render_distributed(const Scene &scene, const RenderOptions &options, ImageWriter &writer);
+
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __GBUFFER_HPP__
+#define __GBUFFER_HPP__
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "material.hpp"
+#include "vectors.hpp"
+
+// Surface vue par le rayon primaire d'un pixel : point, normale et matériau touchés, et l'objet
+// (NO_OBJECT quand le rayon ne voit que le fond)
+struct GBufferSample {
+    static constexpr uint32_t NO_OBJECT = std::numeric_limits<uint32_t>::max();
+
+    Vec3f point;
+    Vec3f normal;
+    uint32_t object;
+    MaterialId material;
+    uint16_t padding;
+};
+
+// G-buffer : la surface vue par chaque pixel, calculée une fois et gardée sur disque. Les rendus suivants
+// de la même géométrie, vue par la même caméra, repartent de ces surfaces sans relancer les rayons
+// primaires : seuls l'éclairage et les rayons secondaires sont recalculés, si bien que lumières et
+// paramètres des matériaux peuvent changer d'un rendu à l'autre.
+class GBuffer {
+public:
+    // fingerprint résume la géométrie de la scène : un G-buffer n'est relu que pour la même empreinte
+    GBuffer(int width, int height, double fov, uint32_t object_count, uint32_t fingerprint)
+        : m_width(width), m_height(height), m_object_count(object_count), m_fingerprint(fingerprint),
+          m_samples(static_cast<size_t>(width)*height) {
+        std::memcpy(m_fov, &fov, sizeof(m_fov));
+    }
+
+    std::vector<GBufferSample>& get_samples() { return m_samples; }
+    const std::vector<GBufferSample>& get_samples() const { return m_samples; }
+
+    // Écrit le G-buffer dans un fichier temporaire renommé ensuite, comme un point de reprise
+    bool save(const std::string& filename) const {
+        std::string temporary = filename + ".tmp";
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file) return false;
+        file.write(magic(), MAGIC_SIZE);
+        uint32_t header[HEADER_SIZE];
+        fill_header(header);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_samples.data()), m_samples.size()*sizeof(GBufferSample));
+        file.close();
+        if (!file) return false;
+        return std::rename(temporary.c_str(), filename.c_str()) == 0;
+    }
+
+    // Relit un G-buffer. Faux si le fichier n'existe pas ou s'il a été écrit pour une autre image
+    // (dimensions, angle de vue) ou une autre géométrie ; les surfaces ne sont alors pas modifiées.
+    bool load(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) return false;
+        char file_magic[MAGIC_SIZE];
+        uint32_t header[HEADER_SIZE], expected[HEADER_SIZE];
+        fill_header(expected);
+        file.read(file_magic, MAGIC_SIZE);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || std::memcmp(file_magic, magic(), MAGIC_SIZE) != 0 || std::memcmp(header, expected, sizeof(header)) != 0) {
+            return false;
+        }
+        std::vector<GBufferSample> samples(m_samples.size());
+        file.read(reinterpret_cast<char*>(samples.data()), samples.size()*sizeof(GBufferSample));
+        if (!file) return false;
+        m_samples.swap(samples);
+        return true;
+    }
+
+private:
+    static const size_t MAGIC_SIZE = 8;
+    static const char* magic() { return "OORTGBF1"; }
+    static const int HEADER_SIZE = 6;
+
+    void fill_header(uint32_t header[HEADER_SIZE]) const {
+        header[0] = m_width;
+        header[1] = m_height;
+        header[2] = m_fov[0];
+        header[3] = m_fov[1];
+        header[4] = m_object_count;
+        header[5] = m_fingerprint;
+    }
+
+    uint32_t m_width, m_height;
+    uint32_t m_fov[2]; // bits de l'angle de vue (double)
+    uint32_t m_object_count;
+    uint32_t m_fingerprint;
+    std::vector<GBufferSample> m_samples;
+};
+
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __GENERATORS_HPP__
+#define __GENERATORS_HPP__
+#include <cstddef>
+#include <cstdint>
+#include "scene.hpp"
+
+// Scènes procédurales, utilisées pour mesurer les performances (voir bench/bench.cpp).
+// Les objets sont placés dans le champ de la caméra (à l'origine, regard vers -z) et au-dessus du sol (y = -4).
+// Les matériaux sont pris par leur nom dans la bibliothèque de la scène, qui doit contenir ceux de
+// add_default_materials. Une même graine donne toujours la même scène.
+
+// Plan en damier du sol, le même que celui des scènes lues dans un fichier
+void add_checkerboard_floor(Scene& scene);
+
+// count sphères de tailles et de matériaux (ivoire, caoutchouc, métal) aléatoires, une lumière
+void generate_random_spheres(Scene& scene, size_t count, uint32_t seed);
+
+// Grille nx x ny x nz de parallélépipèdes tournés aléatoirement, une lumière
+void generate_parallelepiped_grid(Scene& scene, size_t nx, size_t ny, size_t nz, uint32_t seed);
+
+// count sphères de verre et de miroir : beaucoup de rayons secondaires par pixel, une lumière
+void generate_glass_scene(Scene& scene, size_t count, uint32_t seed);
+
+// object_count sphères éclairées par light_count lumières dont l'intensité totale est constante
+void generate_many_lights(Scene& scene, size_t object_count, size_t light_count, uint32_t seed);
+
+// object_count sphères éclairées par light_count lumières de rayon d'influence radius réparties parmi elles
+void generate_light_rig(Scene& scene, size_t object_count, size_t light_count, float radius, uint32_t seed);
+
+// Forêt de count arbres posés sur le sol : un seul prototype (tronc et feuillage) et count instances
+// tournées et mises à l'échelle aléatoirement, une lumière
+void generate_forest(Scene& scene, size_t count, uint32_t seed);
+
+// Tore maillé de 2 x segments x sides triangles avec normales aux sommets, posé sur le sol, une lumière
+void generate_torus_mesh(Scene& scene, size_t segments, size_t sides);
+
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef __IMAGE_OUTPUT_HPP__
+#define __IMAGE_OUTPUT_HPP__
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include "stats.hpp"
+#include "vectors.hpp"
+
+// Formats d'image produits par le rendu
+enum class ImageFormat {
+    PPM,  // 8 bits par composante, couleurs ramenées dans [0, 1]
+    PFM   // flottants 32 bits par composante, sans perte (HDR)
+};
+
+// Format demandé ("ppm" ou "pfm") ou, si format est vide, déduit de l'extension du fichier
+ImageFormat choose_image_format(const std::string& filename, const std::string& format);
+
+// Ramène count composantes dans [0, 1] et les convertit en octets (noyau vectoriel)
+void quantize_rgb8(const float* values, size_t count, uint8_t* out);
+
+// En-tête du fichier, avant les pixels
+std::string image_header(ImageFormat format, int width, int height);
+
+// Fichier complet (en-tête et pixels) dans un seul tampon
+std::vector<char> encode_image(ImageFormat format, int width, int height, const std::vector<Vec3f>& framebuffer);
+
+// Écrit l'image en une seule écriture. Le nom "-" désigne la sortie standard.
+bool write_image(const std::string& filename, ImageFormat format, int width, int height,
+                 const std::vector<Vec3f>& framebuffer);
+
+// Image écrite par bandes de lignes au fil du rendu, sans être gardée entière en mémoire. Les bandes sont
+// données dans l'ordre des lignes du fichier : de haut en bas en PPM, de bas en haut en PFM (top_down),
+// les lignes de chaque bande restant rangées de haut en bas. Le fichier obtenu est identique à celui de
+// write_image. Le nom "-" désigne la sortie standard.
+class ImageStream {
+public:
+    ImageStream(const std::string& filename, ImageFormat format, int width, int height)
+        : m_filename(filename), m_format(format), m_width(width), m_ok(true) {
+        m_file = filename == "-" ? stdout : std::fopen(filename.c_str(), "wb");
+        if (m_file == nullptr) {
+            std::cerr << "Erreur : impossible d'écrire l'image " << filename << std::endl;
+            m_ok = false;
+            return;
+        }
+        const std::string header = image_header(format, width, height);
+        m_ok = std::fwrite(header.data(), 1, header.size(), m_file) == header.size();
+    }
+    ~ImageStream() { close(); }
+
+    ImageStream(const ImageStream&) = delete;
+    ImageStream& operator=(const ImageStream&) = delete;
+
+    static bool top_down(ImageFormat format) { return format == ImageFormat::PPM; }
+    bool is_ok() const { return m_ok; }
+
+    // Écrit count lignes consécutives de l'image
+    bool write_rows(const Vec3f* rows, int count) {
+        OORT_PHASE_TIMER(Output);
+        if (m_file == nullptr || !m_ok) return false;
+        const size_t row = 3*static_cast<size_t>(m_width);
+        const float* values = reinterpret_cast<const float*>(rows);
+        if (m_format == ImageFormat::PFM) {
+            for (int j = count - 1; j >= 0 && m_ok; j--) {
+                m_ok = std::fwrite(values + j*row, sizeof(float), row, m_file) == row;
+            }
+        } else {
+            m_bytes.resize(row*count);
+            quantize_rgb8(values, row*count, m_bytes.data());
+            m_ok = std::fwrite(m_bytes.data(), 1, m_bytes.size(), m_file) == m_bytes.size();
+        }
+        return m_ok;
+    }
+
+    // Termine l'écriture ; faux si une écriture a échoué
+    bool close() {
+        if (m_file == nullptr) return m_ok;
+        m_ok = (m_file == stdout ? std::fflush(m_file) : std::fclose(m_file)) == 0 && m_ok;
+        m_file = nullptr;
+        if (!m_ok) std::cerr << "Erreur : impossible d'écrire l'image " << m_filename << std::endl;
+        return m_ok;
+    }
+
+private:
+    std::string m_filename;
+    ImageFormat m_format;
+    int m_width;
+    std::FILE* m_file;
+    bool m_ok;
+    std::vector<uint8_t> m_bytes; // lignes converties en octets (PPM)
+};
+
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __IMAGE_WRITER_HPP__
+#define __IMAGE_WRITER_HPP__
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "image_output.hpp"
+#include "vectors.hpp"
+
+// Écriture des images sur un thread dédié : la conversion et l'écriture d'une image se font pendant
+// que les threads de rendu passent à l'image suivante. Au plus MAX_PENDING images attendent d'être
+// écrites ; au-delà, submit attend pour ne pas accumuler les images en mémoire.
+class ImageWriter {
+public:
+    ImageWriter() : m_stop(false), m_busy(false), m_failures(0), m_thread(&ImageWriter::run, this) {}
+
+    // Écrit les images restantes avant de s'arrêter
+    ~ImageWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    // L'image est prise en charge par l'écrivain, qui devient propriétaire des pixels
+    void submit(const std::string& filename, ImageFormat format, int width, int height, std::vector<Vec3f>&& framebuffer) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_pending.size() < MAX_PENDING; });
+        m_pending.push_back({filename, format, width, height, std::move(framebuffer)});
+        m_condition.notify_all();
+    }
+
+    // Attend que toutes les images soumises soient écrites et rend le nombre d'échecs d'écriture
+    size_t wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+        return m_failures;
+    }
+
+private:
+    static const size_t MAX_PENDING = 2;
+
+    struct PendingImage {
+        std::string filename;
+        ImageFormat format;
+        int width, height;
+        std::vector<Vec3f> framebuffer;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_condition.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+            if (m_pending.empty()) return;
+            PendingImage image = std::move(m_pending.front());
+            m_pending.pop_front();
+            m_busy = true;
+            m_condition.notify_all();
+
+            lock.unlock();
+            bool ok = write_image(image.filename, image.format, image.width, image.height, image.framebuffer);
+            lock.lock();
+
+            m_busy = false;
+            if (!ok) m_failures++;
+            m_condition.notify_all();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<PendingImage> m_pending;
+    bool m_stop;
+    bool m_busy;       // une image est en cours d'écriture
+    size_t m_failures;
+    std::thread m_thread; // démarré en dernier, une fois les autres membres initialisés
+};
+
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef __INSTANCE_HPP__
+#define __INSTANCE_HPP__
+#include <vector>
+#include <limits>
+#include "object.hpp"
+#include "bvh.hpp"
+#include "transform.hpp"
+#include "packet.hpp"
+#include "vectors.hpp"
+
+// Copie placée d'un prototype partagé : l'instance ne garde qu'un pointeur vers le prototype et sa
+// transformation (avec l'inverse, calculée une fois). Les rayons sont ramenés dans l'espace du prototype,
+// qui est décrit une seule fois en mémoire quel que soit le nombre de ses instances.
+// Le prototype appartient à la scène (Scene::add_prototype) et n'est jamais ajouté à ses objets.
+class Instance : public Object {
+public:
+    // Les matériaux sont ceux du prototype
+    Instance(const Object* prototype, const Transform& transform)
+        : Object(0), m_prototype(prototype), m_transform(transform), m_inverse(transform.inverse()),
+          m_override_material(false) {}
+
+    // Un seul matériau pour toute l'instance, à la place de ceux du prototype
+    Instance(const Object* prototype, const Transform& transform, MaterialId material)
+        : Object(material), m_prototype(prototype), m_transform(transform), m_inverse(transform.inverse()),
+          m_override_material(true) {}
+
+    // La direction locale est renormalisée (les primitives supposent des directions unitaires) :
+    // les distances locales sont celles du rayon global multipliées par scale
+    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0,
+                       float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const override {
+        Vec3f local_orig = m_inverse.apply_point(orig);
+        Vec3f local_dir = m_inverse.apply_vector(dir);
+        const float scale = local_dir.norm();
+        local_dir = local_dir / scale;
+        float t;
+        if (!m_prototype->ray_intersect(local_orig, local_dir, t, t_min*scale, t_max*scale)) return false;
+        t0 = t / scale;
+        // L'arrondi du retour en distance globale peut faire sortir t0 de l'intervalle
+        return t0 >= t_min && t0 < t_max;
+    }
+
+    // Le paquet entier est transformé, puis testé contre le prototype avec ses propres noyaux
+    void ray_intersect_packet(RayPacket& packet, int32_t id) const override {
+        RayPacket local;
+        float scale[PACKET_SIZE];
+        for (int k = 0; k < PACKET_SIZE; k++) {
+            Vec3f o = m_inverse.apply_point(Vec3f(packet.ox[k], packet.oy[k], packet.oz[k]));
+            Vec3f d = m_inverse.apply_vector(Vec3f(packet.dx[k], packet.dy[k], packet.dz[k]));
+            scale[k] = d.norm();
+            d = d / scale[k];
+            local.ox[k] = o.x; local.oy[k] = o.y; local.oz[k] = o.z;
+            local.dx[k] = d.x; local.dy[k] = d.y; local.dz[k] = d.z;
+            local.t[k] = packet.t[k]*scale[k];
+            local.object[k] = PACKET_NO_HIT;
+        }
+        packet_prepare(local);
+        m_prototype->ray_intersect_packet(local, id);
+        for (int k = 0; k < PACKET_SIZE; k++) {
+            if (local.object[k] == PACKET_NO_HIT) continue;
+            float t = local.t[k] / scale[k];
+            if (t < packet.t[k]) {
+                packet.t[k] = t;
+                packet.object[k] = id;
+            }
+        }
+    }
+
+    Vec3f get_position() const override { return m_transform.get_translation(); }
+    void set_position(const Vec3f& position) override {
+        m_transform.set_translation(position);
+        m_inverse = m_transform.inverse();
+    }
+
+    const Object* get_prototype() const { return m_prototype; }
+    const Transform& get_transform() const { return m_transform; }
+    // Vrai si un seul matériau remplace ceux du prototype
+    bool overrides_material() const { return m_override_material; }
+
+    MaterialId get_material_id(const Vec3f& point) const override {
+        if (m_override_material) return Object::get_material_id(point);
+        return m_prototype->get_material_id(m_inverse.apply_point(point));
+    }
+
+    Vec3f get_normal(const Vec3f& point) const override {
+        return to_global_normal(m_prototype->get_normal(m_inverse.apply_point(point)));
+    }
+
+    void get_surface(const Vec3f& orig, const Vec3f& dir, float t, Vec3f& normal, MaterialId& material) const override {
+        Vec3f local_dir = m_inverse.apply_vector(dir);
+        const float scale = local_dir.norm();
+        local_dir = local_dir / scale;
+        Vec3f local_normal;
+        m_prototype->get_surface(m_inverse.apply_point(orig), local_dir, t*scale, local_normal, material);
+        normal = to_global_normal(local_normal);
+        if (m_override_material) material = Object::get_material_id(orig + dir*t);
+    }
+
+    AABB get_bounds() const override {
+        if (!is_bounded()) return m_prototype->get_bounds();
+        return m_transform.apply_bounds(m_prototype->get_bounds());
+    }
+    bool is_bounded() const override { return m_prototype->is_bounded(); }
+
+private:
+    const Object* m_prototype;
+    Transform m_transform; // espace du prototype -> scène
+    Transform m_inverse;   // scène -> espace du prototype
+    bool m_override_material;
+
+    // Les normales se transforment par la transposée de l'inverse
+    Vec3f to_global_normal(const Vec3f& normal) const {
+        return m_inverse.apply_transposed(normal).normalize();
+    }
+};
+
+
+// Ensemble d'objets traité comme un seul, avec sa propre BVH. Sert de prototype aux objets composés
+// de plusieurs primitives (un arbre : un tronc et un feuillage). Le groupe, qui doit contenir au moins
+// un objet, en devient propriétaire.
+class Group : public Object {
+public:
+    explicit Group(const std::vector<Object*>& children) : Object(0), m_children(children) { build(); }
+    ~Group() { for (Object* child : m_children) delete child; }
+
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0,
+                       float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const override {
+        size_t child;
+        return closest(orig, dir, t_min, t_max, t0, child);
+    }
+
+    // Tous les enfants touchés écrivent le même identifiant : seul compte que le groupe soit touché
+    void ray_intersect_packet(RayPacket& packet, int32_t id) const override {
+        for (size_t i = m_bounded_count; i < m_children.size(); i++) m_children[i]->ray_intersect_packet(packet, id);
+        m_bvh.intersect_packet(packet, [&](size_t slot) { m_children[slot]->ray_intersect_packet(packet, id); });
+    }
+
+    // Centre de la boîte englobante ; déplacer le groupe déplace tous ses objets
+    Vec3f get_position() const override { return m_bounds.get_center(); }
+    void set_position(const Vec3f& position) override {
+        const Vec3f delta = position - get_position();
+        for (Object* child : m_children) child->set_position(child->get_position() + delta);
+        build();
+    }
+
+    const std::vector<Object*>& get_children() const { return m_children; }
+
+    // Sans le rayon, l'objet touché est le premier dont la boîte contient le point
+    MaterialId get_material_id(const Vec3f& point) const override { return child_at(point)->get_material_id(point); }
+    Vec3f get_normal(const Vec3f& point) const override { return child_at(point)->get_normal(point); }
+
+    // L'objet touché est retrouvé en relançant le rayon : la recherche de l'intersection la plus proche
+    // refait les mêmes calculs que ray_intersect et retombe sur le même objet
+    void get_surface(const Vec3f& orig, const Vec3f& dir, float t, Vec3f& normal, MaterialId& material) const override {
+        float t_child;
+        size_t child;
+        if (!closest(orig, dir, 0.f, std::numeric_limits<float>::max(), t_child, child)) {
+            Object::get_surface(orig, dir, t, normal, material);
+            return;
+        }
+        m_children[child]->get_surface(orig, dir, t, normal, material);
+    }
+
+    AABB get_bounds() const override { return m_bounds; }
+    bool is_bounded() const override { return m_bounded_count == m_children.size(); }
+
+private:
+    static constexpr float BOUNDS_EPSILON = 1e-4f;
+
+    std::vector<Object*> m_children; // objets bornés dans l'ordre des feuilles de la BVH, puis objets infinis
+    size_t m_bounded_count;
+    BVH m_bvh;
+    AABB m_bounds;
+
+    void build() {
+        std::vector<Object*> bounded, unbounded;
+        std::vector<AABB> bounds;
+        m_bounds = AABB();
+        for (Object* child : m_children) {
+            if (!child->is_bounded()) {
+                unbounded.push_back(child);
+                continue;
+            }
+            AABB box = child->get_bounds();
+            m_bounds.expand(box);
+            box.pad(BOUNDS_EPSILON);
+            bounds.push_back(box);
+            bounded.push_back(child);
+        }
+        m_bvh.build(bounds);
+        m_children.clear();
+        for (size_t slot = 0; slot < bounded.size(); slot++) m_children.push_back(bounded[m_bvh.primitive_index(slot)]);
+        m_bounded_count = m_children.size();
+        m_children.insert(m_children.end(), unbounded.begin(), unbounded.end());
+        if (!is_bounded()) {
+            const float inf = std::numeric_limits<float>::infinity();
+            m_bounds = AABB(Vec3f(-inf, -inf, -inf), Vec3f(inf, inf, inf));
+        }
+    }
+
+    bool closest(const Vec3f& orig, const Vec3f& dir, float t_min, float t_max, float& t0, size_t& child) const {
+        bool found = false;
+        for (size_t i = m_bounded_count; i < m_children.size(); i++) {
+            float t;
+            if (m_children[i]->ray_intersect(orig, dir, t, t_min, t_max)) {
+                t_max = t;
+                child = i;
+                found = true;
+            }
+        }
+        m_bvh.intersect(orig, dir, t_min, t_max, [&](size_t slot, float tmin, float& tmax) {
+            float t;
+            if (m_children[slot]->ray_intersect(orig, dir, t, tmin, tmax)) {
+                tmax = t;
+                child = slot;
+                found = true;
+            }
+        });
+        t0 = t_max;
+        return found;
+    }
+
+    const Object* child_at(const Vec3f& point) const {
+        for (size_t i = 0; i < m_bounded_count; i++) {
+            AABB box = m_children[i]->get_bounds();
+            box.pad(BOUNDS_EPSILON);
+            Vec3f lo = box.get_min(), hi = box.get_max();
+            if (point.x >= lo.x && point.y >= lo.y && point.z >= lo.z &&
+                point.x <= hi.x && point.y <= hi.y && point.z <= hi.z) return m_children[i];
+        }
+        return m_children.back();
+    }
+};
+
+
+#endif
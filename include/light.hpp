@@ -1,14 +1,31 @@
 #ifndef __LIGHT_HPP__
 #define __LIGHT_HPP__
+#include <limits>
 #include "vectors.hpp"
 
+// Lumière ponctuelle. Par défaut elle éclaire toute la scène avec la même intensité ; avec un rayon
+// d'influence fini, son intensité décroît jusqu'à s'annuler à cette distance, ce qui permet d'ignorer
+// la lumière loin de sa position (voir LightTree).
 class Light {
 public:
     Vec3f position;
     float intensity;
+    float radius;
 
-    Light(const Vec3f& p, const float i) : position(p), intensity(i) {}
+    Light(const Vec3f& p, const float i, const float r = std::numeric_limits<float>::infinity())
+        : position(p), intensity(i), radius(r) {}
+
+    bool is_bounded() const { return radius < std::numeric_limits<float>::infinity(); }
+
+    // Facteur d'atténuation à la distance d : (1 - (d/r)²)², continu et de dérivée nulle en r
+    float attenuation(float distance) const {
+        if (!is_bounded()) return 1.f;
+        const float x = distance / radius;
+        if (x >= 1.f) return 0.f;
+        const float f = 1.f - x*x;
+        return f*f;
+    }
 };
 
 
-#endif
\ No newline at end of file
+#endif
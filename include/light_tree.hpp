@@ -0,0 +1,66 @@
+#ifndef __LIGHT_TREE_HPP__
+#define __LIGHT_TREE_HPP__
+#include <vector>
+#include <cstdint>
+#include "light.hpp"
+#include "aabb.hpp"
+#include "bvh.hpp"
+#include "vectors.hpp"
+
+// Recherche des lumières qui éclairent un point. Les lumières à rayon d'influence fini sont rangées dans
+// une BVH des boîtes de leurs sphères d'influence : un point n'en visite que les quelques feuilles qui le
+// contiennent, quel que soit le nombre de lumières de la scène. Les lumières sans rayon éclairent partout.
+class LightTree {
+public:
+    void build(const std::vector<Light>& lights) {
+        m_unbounded.clear();
+        std::vector<AABB> bounds;
+        std::vector<uint32_t> bounded;
+        for (size_t i = 0; i < lights.size(); i++) {
+            if (!lights[i].is_bounded()) {
+                m_unbounded.push_back(static_cast<uint32_t>(i));
+                continue;
+            }
+            const float r = lights[i].radius;
+            bounds.push_back(AABB(lights[i].position - Vec3f(r, r, r), lights[i].position + Vec3f(r, r, r)));
+            bounded.push_back(static_cast<uint32_t>(i));
+        }
+        m_bvh.build(bounds);
+
+        // Les sphères sont recopiées dans l'ordre des feuilles, comme les objets de la scène
+        m_spheres.resize(bounded.size());
+        for (size_t slot = 0; slot < bounded.size(); slot++) {
+            const Light& light = lights[bounded[m_bvh.primitive_index(slot)]];
+            m_spheres[slot] = {light.position, light.radius*light.radius, bounded[m_bvh.primitive_index(slot)]};
+        }
+    }
+
+    // Vrai si au moins une lumière a un rayon d'influence fini
+    bool has_bounded() const { return !m_spheres.empty(); }
+
+    // Appelle visit(indice) pour chaque lumière qui éclaire le point : les lumières sans rayon, puis celles
+    // dont la sphère d'influence contient le point
+    template <typename Visit>
+    void lights_at(const Vec3f& point, Visit&& visit) const {
+        for (uint32_t i : m_unbounded) visit(i);
+        m_bvh.query_point(point, [&](size_t slot) {
+            const Influence& sphere = m_spheres[slot];
+            const Vec3f d = point - sphere.center;
+            if (d*d < sphere.radius2) visit(sphere.light);
+        });
+    }
+
+private:
+    struct Influence {
+        Vec3f center;
+        float radius2;
+        uint32_t light; // indice dans Scene::get_lights()
+    };
+
+    std::vector<uint32_t> m_unbounded;
+    std::vector<Influence> m_spheres;
+    BVH m_bvh;
+};
+
+
+#endif
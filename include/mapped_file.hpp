@@ -0,0 +1,69 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstddef>
+#ifdef __unix__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Fichier projeté en mémoire en lecture seule : son contenu est lu directement dans les pages du système,
+// sans copie dans un tampon. Sur les systèmes sans mmap, le fichier est lu en entier en mémoire.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) : m_data(nullptr), m_size(0), m_mapped(false) {
+#ifdef __unix__
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            if (info.st_size == 0) {
+                m_data = ""; // fichier vide, mais ouvert
+            } else {
+                void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED) {
+                    madvise(address, info.st_size, MADV_SEQUENTIAL);
+                    m_data = static_cast<const char*>(address);
+                    m_size = info.st_size;
+                    m_mapped = true;
+                }
+            }
+        }
+        close(fd);
+#else
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) return;
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        if (m_data == nullptr) m_data = "";
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef __unix__
+        if (m_mapped) munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const { return m_data != nullptr; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::vector<char> m_buffer;
+};
+
+
+#endif
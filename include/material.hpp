@@ -0,0 +1,87 @@
+#ifndef __MATERIAL_HPP__
+#define __MATERIAL_HPP__
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cassert>
+#include <limits>
+#include <unordered_map>
+#include "fast_math.hpp"
+#include "vectors.hpp"
+
+class Material {
+public:
+    Material() {}
+    Material(const Vec3f& diffuse_color, const Vec4f& albedo, float specular_exponent, float refractive_index)
+        : m_diffuseColor(diffuse_color), m_albedo(albedo), m_specularExponent(specular_exponent), m_refractiveIndex(refractive_index),
+          m_specularPower(specular_exponent) {}
+
+
+    // Getters et setters pour les propriétés du matériau
+    Vec3f get_diffuse_color() const { return m_diffuseColor; }
+    void set_diffuse_color(const Vec3f& diffuse_color) { m_diffuseColor = diffuse_color; }
+    Vec4f get_albedo() const { return m_albedo; }
+    void set_albedo(const Vec4f& albedo) { m_albedo = albedo; }
+    float get_specular_exponent() const { return m_specularExponent; }
+    void set_specular_exponent(float specular_exponent) {
+        m_specularExponent = specular_exponent;
+        m_specularPower = SpecularPower(specular_exponent);
+    }
+    // Terme spéculaire précalculé pour l'exposant, utilisé par l'éclairage rapide
+    const SpecularPower& get_specular_power() const { return m_specularPower; }
+    float get_refractive_index() const { return m_refractiveIndex; }
+    void set_refractive_index(float refractive_index) { m_refractiveIndex = refractive_index; }
+
+private:
+    Vec3f m_diffuseColor;
+    Vec4f m_albedo;
+    float m_specularExponent;
+    float m_refractiveIndex;
+    SpecularPower m_specularPower;
+};
+
+
+// Indice compact d'un matériau dans la MaterialLibrary
+typedef uint16_t MaterialId;
+
+// Table des matériaux partagée par tous les objets de la scène, qui n'en gardent que l'indice
+class MaterialLibrary {
+public:
+    MaterialLibrary() {}
+
+    // Ajoute un matériau sous un nom et renvoie son indice. Un nom déjà présent est redéfini.
+    MaterialId add(const std::string& name, const Material& material) {
+        auto it = m_ids.find(name);
+        if (it != m_ids.end()) {
+            m_materials[it->second] = material;
+            return it->second;
+        }
+        assert(m_materials.size() < std::numeric_limits<MaterialId>::max());
+        MaterialId id = static_cast<MaterialId>(m_materials.size());
+        m_materials.push_back(material);
+        m_names.push_back(name);
+        m_ids[name] = id;
+        return id;
+    }
+
+    // Recherche d'un matériau par son nom (table de hachage)
+    bool find(const std::string& name, MaterialId& id) const {
+        auto it = m_ids.find(name);
+        if (it == m_ids.end()) return false;
+        id = it->second;
+        return true;
+    }
+
+    const Material& get(MaterialId id) const { return m_materials[id]; }
+    Material& get(MaterialId id) { return m_materials[id]; }
+    const std::string& get_name(MaterialId id) const { return m_names[id]; }
+    size_t size() const { return m_materials.size(); }
+
+private:
+    std::vector<Material> m_materials;
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, MaterialId> m_ids;
+};
+
+
+#endif
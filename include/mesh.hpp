@@ -0,0 +1,265 @@
+#ifndef __MESH_HPP__
+#define __MESH_HPP__
+#include <vector>
+#include <string>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "object.hpp"
+#include "bvh.hpp"
+#include "packet.hpp"
+#include "stats.hpp"
+#include "vectors.hpp"
+
+// Maillage de triangles indexé : tableaux de sommets et de normales partagés entre les triangles, qui n'en
+// gardent que les indices. Le maillage a sa propre BVH et entre dans la scène comme un seul objet, quel que
+// soit son nombre de triangles. Les sommets sont exprimés dans le repère du maillage, placé dans la scène
+// par une translation (get_position).
+class TriangleMesh : public Object {
+public:
+    // Indice de normale d'un sommet de triangle sans normale : la normale géométrique du triangle est utilisée
+    static constexpr uint32_t NO_NORMAL = std::numeric_limits<uint32_t>::max();
+
+    // triangles : trois indices de sommets par triangle. normal_indices : trois indices de normales par
+    // triangle, ou vide si le maillage n'a pas de normales. Les indices doivent être valides.
+    TriangleMesh(std::vector<Vec3f> vertices, std::vector<uint32_t> triangles, std::vector<Vec3f> normals,
+                 std::vector<uint32_t> normal_indices, MaterialId material, const Vec3f& position = Vec3f(0, 0, 0))
+        : Object(material), m_vertices(std::move(vertices)), m_normals(std::move(normals)),
+          m_triangles(std::move(triangles)), m_normal_indices(std::move(normal_indices)), m_position(position) {
+        build();
+    }
+
+    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0,
+                       float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const override {
+        uint32_t triangle;
+        return closest(orig - m_position, dir, t_min, t_max, t0, triangle);
+    }
+
+    // Le paquet parcourt la BVH du maillage ; chaque triangle d'une feuille atteinte est testé pour chaque rayon
+    void ray_intersect_packet(RayPacket& packet, int32_t id) const override {
+        RayPacket local = packet;
+        TriangleRay rays[PACKET_SIZE];
+        for (int k = 0; k < PACKET_SIZE; k++) {
+            local.ox[k] -= m_position.x;
+            local.oy[k] -= m_position.y;
+            local.oz[k] -= m_position.z;
+            rays[k] = prepare_ray(Vec3f(local.ox[k], local.oy[k], local.oz[k]), Vec3f(local.dx[k], local.dy[k], local.dz[k]));
+        }
+        m_bvh.intersect_packet(local, [&](size_t slot) {
+            for (int k = 0; k < PACKET_SIZE; k++) {
+                float t;
+                if (intersect_triangle(rays[k], static_cast<uint32_t>(slot), 0.f, local.t[k], t, nullptr)) {
+                    local.t[k] = t;
+                    local.object[k] = id;
+                }
+            }
+        });
+        for (int k = 0; k < PACKET_SIZE; k++) {
+            packet.t[k] = local.t[k];
+            packet.object[k] = local.object[k];
+        }
+    }
+
+    Vec3f get_position() const override { return m_position; }
+    void set_position(const Vec3f& position) override { m_position = position; }
+
+    // Sans le rayon, le triangle est retrouvé par de courts rayons menés par le point le long des trois axes
+    Vec3f get_normal(const Vec3f& point) const override {
+        const Vec3f local = point - m_position;
+        Vec3f extent = m_bounds.get_extent();
+        const float probe = 1e-4f * extent.norm();
+        const Vec3f axes[3] = {Vec3f(1, 0, 0), Vec3f(0, 1, 0), Vec3f(0, 0, 1)};
+        for (const Vec3f& axis : axes) {
+            float t;
+            uint32_t triangle;
+            if (closest(local - axis*probe, axis, 0.f, 2.f*probe, t, triangle)) {
+                return surface_normal(prepare_ray(local - axis*probe, axis), triangle);
+            }
+        }
+        return Vec3f(0, 1, 0);
+    }
+
+    // Le triangle touché est retrouvé en relançant le rayon dans la BVH
+    void get_surface(const Vec3f& orig, const Vec3f& dir, float t, Vec3f& normal, MaterialId& material) const override {
+        const Vec3f local = orig - m_position;
+        float t_triangle;
+        uint32_t triangle;
+        material = get_material_id(orig + dir*t);
+        if (!closest(local, dir, 0.f, std::numeric_limits<float>::max(), t_triangle, triangle)) {
+            normal = get_normal(orig + dir*t);
+            return;
+        }
+        normal = surface_normal(prepare_ray(local, dir), triangle);
+    }
+
+    AABB get_bounds() const override { return AABB(m_bounds.get_min() + m_position, m_bounds.get_max() + m_position); }
+
+    // Fichier OBJ d'où le maillage a été lu (load_obj), vide s'il a été construit autrement
+    const std::string& get_source() const { return m_source; }
+    void set_source(const std::string& source) { m_source = source; }
+
+    size_t triangle_count() const { return m_triangles.size() / 3; }
+    size_t vertex_count() const { return m_vertices.size(); }
+
+    // Empreinte FNV-1a des sommets, normales et indices, mot de 32 bits par mot de 32 bits
+    uint32_t content_hash() const {
+        uint32_t hash = 2166136261u;
+        auto add = [&hash](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t k = 0; k + 4 <= size; k += 4) {
+                uint32_t word;
+                std::memcpy(&word, bytes + k, sizeof(word));
+                hash = (hash ^ word)*16777619u;
+            }
+        };
+        add(m_vertices.data(), m_vertices.size()*sizeof(Vec3f));
+        add(m_normals.data(), m_normals.size()*sizeof(Vec3f));
+        add(m_triangles.data(), m_triangles.size()*sizeof(uint32_t));
+        add(m_normal_indices.data(), m_normal_indices.size()*sizeof(uint32_t));
+        return hash;
+    }
+
+    // Mémoire occupée par le maillage (sommets, normales, indices) et par sa BVH, en octets
+    size_t memory_usage() const {
+        return sizeof(*this) + (m_vertices.capacity() + m_normals.capacity())*sizeof(Vec3f) +
+               (m_triangles.capacity() + m_normal_indices.capacity())*sizeof(uint32_t) + m_bvh.memory_usage();
+    }
+
+private:
+    std::vector<Vec3f> m_vertices;
+    std::vector<Vec3f> m_normals;
+    std::vector<uint32_t> m_triangles;      // trois indices de sommets par triangle, dans l'ordre des feuilles de la BVH
+    std::vector<uint32_t> m_normal_indices; // trois indices de normales par triangle, vide sans normales
+    Vec3f m_position;
+    AABB m_bounds;                          // dans le repère du maillage
+    std::string m_source;
+    BVH m_bvh;
+
+    // Rayon préparé pour le test étanche de Woop, Benthin et Wald : l'axe kz est la composante dominante
+    // de la direction, et le cisaillement (sx, sy, sz) ramène la direction sur cet axe
+    struct TriangleRay {
+        Vec3f orig;
+        int kx, ky, kz;
+        float sx, sy, sz;
+    };
+
+    static TriangleRay prepare_ray(const Vec3f& orig, const Vec3f& dir) {
+        TriangleRay ray;
+        ray.orig = orig;
+        const float ax = std::abs(dir.x), ay = std::abs(dir.y), az = std::abs(dir.z);
+        ray.kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+        ray.kx = (ray.kz + 1) % 3;
+        ray.ky = (ray.kx + 1) % 3;
+        // L'ordre des deux autres axes est inversé pour garder l'orientation des triangles
+        if (dir[ray.kz] < 0.f) std::swap(ray.kx, ray.ky);
+        ray.sx = dir[ray.kx] / dir[ray.kz];
+        ray.sy = dir[ray.ky] / dir[ray.kz];
+        ray.sz = 1.f / dir[ray.kz];
+        return ray;
+    }
+
+    // Test étanche : un rayon qui passe par une arête ou un sommet partagés touche toujours au moins un des
+    // triangles voisins. Les coordonnées barycentriques (U, V, W) sont recalculées en double précision quand
+    // l'une d'elles est nulle en simple précision. barycentric, s'il est fourni, reçoit les poids de A, B et C.
+    bool intersect_triangle(const TriangleRay& ray, uint32_t triangle, float t_min, float t_max, float& t,
+                            float* barycentric) const {
+        OORT_STAT(TriangleTests);
+        const uint32_t* v = &m_triangles[3*triangle];
+        const Vec3f A = m_vertices[v[0]] - ray.orig;
+        const Vec3f B = m_vertices[v[1]] - ray.orig;
+        const Vec3f C = m_vertices[v[2]] - ray.orig;
+        const float Ax = A[ray.kx] - ray.sx*A[ray.kz], Ay = A[ray.ky] - ray.sy*A[ray.kz];
+        const float Bx = B[ray.kx] - ray.sx*B[ray.kz], By = B[ray.ky] - ray.sy*B[ray.kz];
+        const float Cx = C[ray.kx] - ray.sx*C[ray.kz], Cy = C[ray.ky] - ray.sy*C[ray.kz];
+
+        float U = Cx*By - Cy*Bx;
+        float V = Ax*Cy - Ay*Cx;
+        float W = Bx*Ay - By*Ax;
+        if (U == 0.f || V == 0.f || W == 0.f) {
+            U = static_cast<float>(double(Cx)*double(By) - double(Cy)*double(Bx));
+            V = static_cast<float>(double(Ax)*double(Cy) - double(Ay)*double(Cx));
+            W = static_cast<float>(double(Bx)*double(Ay) - double(By)*double(Ax));
+        }
+        // Le rayon doit être du même côté des trois arêtes ; les deux faces du triangle sont visibles
+        if ((U < 0.f || V < 0.f || W < 0.f) && (U > 0.f || V > 0.f || W > 0.f)) return false;
+        const float det = U + V + W;
+        if (det == 0.f) return false;
+
+        const float T = U*(ray.sz*A[ray.kz]) + V*(ray.sz*B[ray.kz]) + W*(ray.sz*C[ray.kz]);
+        t = T / det;
+        if (!(t >= t_min && t < t_max)) return false;
+        if (barycentric != nullptr) {
+            barycentric[0] = U / det;
+            barycentric[1] = V / det;
+            barycentric[2] = W / det;
+        }
+        return true;
+    }
+
+    bool closest(const Vec3f& orig, const Vec3f& dir, float t_min, float t_max, float& t0, uint32_t& triangle) const {
+        const TriangleRay ray = prepare_ray(orig, dir);
+        bool found = false;
+        m_bvh.intersect(orig, dir, t_min, t_max, [&](size_t slot, float tmin, float& tmax) {
+            float t;
+            if (intersect_triangle(ray, static_cast<uint32_t>(slot), tmin, tmax, t, nullptr)) {
+                tmax = t;
+                triangle = static_cast<uint32_t>(slot);
+                found = true;
+            }
+        });
+        t0 = t_max;
+        return found;
+    }
+
+    // Normale interpolée aux sommets si le triangle en a, normale géométrique sinon. Comme dans les fichiers
+    // OBJ, la normale géométrique sort du côté où les sommets tournent dans le sens trigonométrique.
+    Vec3f surface_normal(const TriangleRay& ray, uint32_t triangle) const {
+        const uint32_t* v = &m_triangles[3*triangle];
+        if (!m_normal_indices.empty()) {
+            const uint32_t* n = &m_normal_indices[3*triangle];
+            float barycentric[3];
+            float t;
+            if (n[0] != NO_NORMAL && n[1] != NO_NORMAL && n[2] != NO_NORMAL &&
+                intersect_triangle(ray, triangle, -std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), t, barycentric)) {
+                Vec3f normal = m_normals[n[0]]*barycentric[0] + m_normals[n[1]]*barycentric[1] + m_normals[n[2]]*barycentric[2];
+                if (normal*normal > 0.f) return normal.normalize();
+            }
+        }
+        return cross(m_vertices[v[1]] - m_vertices[v[0]], m_vertices[v[2]] - m_vertices[v[0]]).normalize();
+    }
+
+    // Construit la BVH des triangles, puis les range dans l'ordre de ses feuilles
+    void build() {
+        const size_t count = m_triangles.size() / 3;
+        std::vector<AABB> bounds(count);
+        m_bounds = AABB();
+        for (size_t i = 0; i < count; i++) {
+            for (int c = 0; c < 3; c++) bounds[i].expand(m_vertices[m_triangles[3*i + c]]);
+            m_bounds.expand(bounds[i]);
+        }
+        // Les boîtes des triangles parallèles à un axe sont plates : une petite marge, relative à la taille
+        // du maillage, évite qu'un rayon parallèle à la boîte ne la manque
+        Vec3f extent = m_bounds.get_extent();
+        const float margin = 1e-6f * extent.norm();
+        for (AABB& box : bounds) box.pad(margin);
+        m_bounds.pad(margin);
+        m_bvh.build(bounds);
+
+        std::vector<uint32_t> triangles(m_triangles.size());
+        std::vector<uint32_t> normal_indices(m_normal_indices.size());
+        for (size_t slot = 0; slot < count; slot++) {
+            const size_t i = m_bvh.primitive_index(slot);
+            for (int c = 0; c < 3; c++) {
+                triangles[3*slot + c] = m_triangles[3*i + c];
+                if (!normal_indices.empty()) normal_indices[3*slot + c] = m_normal_indices[3*i + c];
+            }
+        }
+        m_triangles.swap(triangles);
+        m_normal_indices.swap(normal_indices);
+    }
+};
+
+
+#endif
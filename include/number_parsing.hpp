@@ -0,0 +1,26 @@
+#ifndef __NUMBER_PARSING_HPP__
+#define __NUMBER_PARSING_HPP__
+#include <string>
+#include <limits>
+#include <charconv>
+#include <system_error>
+
+// Lit un nombre des lignes de commande ou des fichiers de travaux avec std::from_chars, comme les champs
+// des fichiers de scène ; le signe + initial est accepté.
+// Faux si le texte n'est pas un nombre en entier (« 64x »), s'il sort des valeurs du type ou de [min, max] ;
+// value n'est alors pas modifiée.
+template <typename T>
+bool parse_number(const std::string& text, T& value, T min = std::numeric_limits<T>::lowest(),
+                  T max = std::numeric_limits<T>::max()) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    if (begin < end && *begin == '+') begin++;
+    T parsed;
+    const std::from_chars_result result = std::from_chars(begin, end, parsed);
+    if (result.ec != std::errc() || result.ptr != end || !(parsed >= min && parsed <= max)) return false;
+    value = parsed;
+    return true;
+}
+
+
+#endif
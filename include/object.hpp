@@ -1,53 +1,61 @@
 #ifndef __OBJECT_HPP__
 #define __OBJECT_HPP__
+#include <limits>
 #include "vectors.hpp"
-
-class Material {
-public:
-    Material() {}
-    Material(const Vec3f& diffuse_color, const Vec4f& albedo, float specular_exponent, float refractive_index)
-        : m_diffuseColor(diffuse_color), m_albedo(albedo), m_specularExponent(specular_exponent), m_refractiveIndex(refractive_index) {}
-
-
-    // Getters et setters pour les propriétés du matériau
-    Vec3f get_diffuse_color() const { return m_diffuseColor; }
-    void set_diffuse_color(const Vec3f& diffuse_color) { m_diffuseColor = diffuse_color; }
-    Vec4f get_albedo() const { return m_albedo; }
-    void set_albedo(const Vec4f& albedo) { m_albedo = albedo; }
-    float get_specular_exponent() const { return m_specularExponent; }
-    void set_specular_exponent(float specular_exponent) { m_specularExponent = specular_exponent; }
-    float get_refractive_index() const { return m_refractiveIndex; }
-    void set_refractive_index(float refractive_index) { m_refractiveIndex = refractive_index; }
-
-private:
-    Vec3f m_diffuseColor;
-    Vec4f m_albedo;
-    float m_specularExponent;
-    float m_refractiveIndex;
-};
-
-
+#include "aabb.hpp"
+#include "material.hpp"
+#include "packet.hpp"
 
 class Object {
 public:
-    Object(Material material) : m_material(material) {}
+    Object(MaterialId material) : m_material(material) {}
     virtual ~Object() {}
 
-    // Méthode pour calculer l'intersection d'un rayon avec l'objet
-    virtual bool ray_intersect(const Vec3f &orig, const Vec3f &dir, float &t0) const = 0;
+    // Méthode pour calculer l'intersection d'un rayon avec l'objet. Seules les intersections dont la distance
+    // est dans [t_min, t_max) sont retenues, ce qui permet d'abandonner le test dès qu'elles en sortent
+    virtual bool ray_intersect(const Vec3f &orig, const Vec3f &dir, float &t0,
+                               float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const = 0;
+
+    // Intersection d'un paquet de rayons avec l'objet, id étant l'indice de l'objet dans la scène.
+    // Par défaut chaque rayon est testé séparément ; les primitives simples utilisent les noyaux vectoriels de packet.hpp
+    virtual void ray_intersect_packet(RayPacket& packet, int32_t id) const {
+        for (int k = 0; k < PACKET_SIZE; k++) {
+            float t;
+            if (ray_intersect(Vec3f(packet.ox[k], packet.oy[k], packet.oz[k]), Vec3f(packet.dx[k], packet.dy[k], packet.dz[k]),
+                              t, 0.f, packet.t[k])) {
+                packet.t[k] = t;
+                packet.object[k] = id;
+            }
+        }
+    }
 
     // Getters et setters pour les propriétés communes à tous les objets
     virtual Vec3f get_position() const = 0;
     virtual void set_position(const Vec3f& position) = 0;
 
-    virtual Material get_material(const Vec3f& intersection_point) const { return m_material; }
-    virtual void set_material(const Material& material) { m_material = material; }
+    // Indice du matériau au point d'intersection dans la MaterialLibrary de la scène
+    virtual MaterialId get_material_id(const Vec3f& intersection_point) const { return m_material; }
+    virtual void set_material_id(MaterialId material) { m_material = material; }
 
     // Méthode pour obtenir le vecteur normal au point d'intersection entre un rayon et l'objet
     virtual Vec3f get_normal(const Vec3f& intersection_point) const = 0;
 
+    // Normale et matériau de l'intersection à la distance t le long d'un rayon touché par ray_intersect.
+    // Par défaut ils sont calculés au point d'intersection ; les objets composés (instances, groupes)
+    // se servent du rayon pour retrouver la partie touchée.
+    virtual void get_surface(const Vec3f& orig, const Vec3f& dir, float t, Vec3f& normal, MaterialId& material) const {
+        const Vec3f point = orig + dir*t;
+        normal = get_normal(point);
+        material = get_material_id(point);
+    }
+
+    // Boîte englobante de l'objet, utilisée pour construire la BVH de la scène
+    virtual AABB get_bounds() const = 0;
+    // Les objets infinis (plans) ne peuvent pas être rangés dans la BVH
+    virtual bool is_bounded() const { return true; }
+
 private:
-    Material m_material;
+    MaterialId m_material;
 };
 
 
@@ -0,0 +1,55 @@
+#ifndef __PACKET_HPP__
+#define __PACKET_HPP__
+#include <cstdint>
+#include <limits>
+
+// Largeur des paquets de rayons : 8 correspond à un registre AVX2, 16 à un registre AVX-512.
+// Se choisit à la compilation avec -DOORT_PACKET_SIZE=16.
+#ifndef OORT_PACKET_SIZE
+#define OORT_PACKET_SIZE 8
+#endif
+const int PACKET_SIZE = OORT_PACKET_SIZE;
+
+// Valeur de RayPacket::object pour un rayon qui ne touche rien
+const int32_t PACKET_NO_HIT = -1;
+
+// Paquet de rayons cohérents rangé en structure de tableaux (une composante par tableau)
+// pour que chaque noyau d'intersection traite tous les rayons du paquet en une instruction vectorielle.
+// Un rayon inutilisé garde t = 0 : l'intervalle [0, t) est vide et il ne touche jamais rien.
+struct alignas(64) RayPacket {
+    float ox[PACKET_SIZE], oy[PACKET_SIZE], oz[PACKET_SIZE];      // origines
+    float dx[PACKET_SIZE], dy[PACKET_SIZE], dz[PACKET_SIZE];      // directions normalisées
+    float inv_dx[PACKET_SIZE], inv_dy[PACKET_SIZE], inv_dz[PACKET_SIZE]; // inverses des directions, pour les boîtes
+    float t[PACKET_SIZE];          // distance de l'intersection la plus proche trouvée (borne supérieure)
+    int32_t object[PACKET_SIZE];   // indice de l'objet le plus proche, PACKET_NO_HIT sinon
+};
+
+// Noyaux vectoriels d'intersection. Chacun teste les rayons du paquet contre une primitive
+// et met à jour t et object pour les rayons qui la touchent plus près.
+// Les versions AVX2 et AVX-512 sont choisies à l'exécution selon le processeur (voir packet.cpp).
+
+// Calcule les inverses des directions une fois le paquet rempli
+void packet_prepare(RayPacket& packet);
+
+// Remplit le paquet avec les rayons primaires issus de l'origine vers les pixels (i0..i0+PACKET_SIZE-1, j).
+// Les rayons à partir de la colonne i_end (fin de la tuile ou de l'image) sont désactivés (t = 0).
+void packet_primary_rays(RayPacket& packet, int i0, int i_end, int j, int width, int height, double tan_half_fov);
+
+void packet_intersect_sphere(RayPacket& packet, float cx, float cy, float cz, float radius, int32_t id);
+
+void packet_intersect_plane(RayPacket& packet, float nx, float ny, float nz, float distance, int32_t id);
+
+// Le parallélépipède est décrit par son centre, ses trois axes (basis = x, y puis z, 3 composantes chacun)
+// et ses demi-dimensions
+void packet_intersect_parallelepiped(RayPacket& packet, const float position[3], const float basis[9],
+                                     const float half_size[3], int32_t id);
+
+// Vrai si au moins un rayon du paquet entre dans la boîte avant sa distance t.
+// t_entry reçoit la plus petite distance d'entrée parmi ces rayons.
+bool packet_intersect_aabb(const RayPacket& packet, const float box_min[3], const float box_max[3], float& t_entry);
+
+// Jeu d'instructions retenu à l'exécution pour les noyaux : "avx512f", "avx2" ou "default"
+const char* packet_isa();
+
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef __PARALLELEPIPED_HPP__
 #define __PARALLELEPIPED_HPP__
 #include "object.hpp"
+#include "stats.hpp"
 #include "vectors.hpp"
+#include <limits>
 
 #define EPSILON 0.00001
 
@@ -10,7 +12,7 @@
 
 class Parallelepiped : public Object {
 public:
-    Parallelepiped(Vec3f position, Vec3f size, Material material,
+    Parallelepiped(Vec3f position, Vec3f size, MaterialId material,
                    float angle_x = 0.f, float angle_y = 0.f, float angle_z = 0.f)
         : Object(material), m_position(position), m_size(size),
           m_half_size(size / 2.f) {
@@ -27,7 +29,15 @@ public:
                               std::cos(angle_x) * std::cos(angle_y));
     }
 
-    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0) const override {
+    // Construction directe à partir des axes du repère local, déjà calculés (scène binaire)
+    Parallelepiped(Vec3f position, Vec3f size, MaterialId material,
+                   const Vec3f& direction_x, const Vec3f& direction_y, const Vec3f& direction_z)
+        : Object(material), m_position(position), m_size(size), m_direction_x(direction_x),
+          m_direction_y(direction_y), m_direction_z(direction_z), m_half_size(size / 2.f) {}
+
+    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0,
+                       float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const override {
+        OORT_STAT(ParallelepipedTests);
         // Transformation du rayon dans le repère local du parallélépipède
         Vec3f local_orig = global_to_local(orig - m_position);
         Vec3f local_dir = global_to_local(dir);
@@ -38,6 +48,8 @@ public:
 
         if (tmin > tmax) std::swap(tmin, tmax);
 
+        if (tmin >= t_max || tmax < t_min) return false;
+
         float tymin = (-local_orig.y - m_half_size.y) / local_dir.y;
         float tymax = (-local_orig.y + m_half_size.y) / local_dir.y;
 
@@ -49,6 +61,8 @@ public:
 
         if (tymax < tmax) tmax = tymax;
 
+        if (tmin >= t_max || tmax < t_min) return false;
+
         float tzmin = (-local_orig.z - m_half_size.z) / local_dir.z;
         float tzmax = (-local_orig.z + m_half_size.z) / local_dir.z;
 
@@ -60,18 +74,35 @@ public:
 
         if (tzmax < tmax) tmax = tzmax;
 
-        // Vérification de la validité des intersections
-        if (tmin < 0) {
+        // Vérification de la validité des intersections : on garde l'entrée si elle est dans l'intervalle,
+        // sinon la sortie (origine du rayon à l'intérieur du parallélépipède)
+        if (tmin < t_min) {
             t0 = tmax;
         } else {
             t0 = tmin;
         }
 
-        return true;
+        return t0 >= t_min && t0 < t_max;
+    }
+
+    void ray_intersect_packet(RayPacket& packet, int32_t id) const override {
+        OORT_STAT_ADD(ParallelepipedTests, PACKET_SIZE);
+        const float position[3] = {m_position.x, m_position.y, m_position.z};
+        const float basis[9] = {m_direction_x.x, m_direction_x.y, m_direction_x.z,
+                                m_direction_y.x, m_direction_y.y, m_direction_y.z,
+                                m_direction_z.x, m_direction_z.y, m_direction_z.z};
+        const float half_size[3] = {m_half_size.x, m_half_size.y, m_half_size.z};
+        packet_intersect_parallelepiped(packet, position, basis, half_size, id);
     }
 
     Vec3f get_position() const override { return m_position; }
     void set_position(const Vec3f& position) override { m_position = position; }
+    Vec3f get_size() const { return m_size; }
+    Vec3f get_half_size() const { return m_half_size; }
+    // Axes du repère local exprimés dans le repère global
+    Vec3f get_direction_x() const { return m_direction_x; }
+    Vec3f get_direction_y() const { return m_direction_y; }
+    Vec3f get_direction_z() const { return m_direction_z; }
 
     Vec3f get_normal(const Vec3f& point) const override {
         // Calcul de la normale à partir du point d'intersection
@@ -94,6 +125,14 @@ public:
         return normal.normalize();
     }
 
+    AABB get_bounds() const override {
+        // Demi-étendue sur chaque axe global des trois axes locaux du parallélépipède
+        Vec3f extent(std::abs(m_direction_x.x) * m_half_size.x + std::abs(m_direction_y.x) * m_half_size.y + std::abs(m_direction_z.x) * m_half_size.z,
+                     std::abs(m_direction_x.y) * m_half_size.x + std::abs(m_direction_y.y) * m_half_size.y + std::abs(m_direction_z.y) * m_half_size.z,
+                     std::abs(m_direction_x.z) * m_half_size.x + std::abs(m_direction_y.z) * m_half_size.y + std::abs(m_direction_z.z) * m_half_size.z);
+        return AABB(m_position - extent, m_position + extent);
+    }
+
 
 private:
     Vec3f m_position;
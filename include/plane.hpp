@@ -1,32 +1,51 @@
 #ifndef __PLANE_HPP__
 #define __PLANE_HPP__
 #include "object.hpp"
+#include "stats.hpp"
 #include "vectors.hpp"
+#include <limits>
 
 class Plane : public Object {
 public:
-    Plane(Vec3f normal, float distance, Material material)
+    Plane(Vec3f normal, float distance, MaterialId material)
         : Object(material), m_normal(normal), m_distance(distance) {}
 
     // Méthode pour calculer l'intersection d'un rayon avec le plan
-    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0) const override {
+    bool ray_intersect(const Vec3f& orig, const Vec3f& dir, float& t0,
+                       float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const override {
+        OORT_STAT(PlaneTests);
         float denom = m_normal * dir;
         if (std::abs(denom) > 1e-6) {
             Vec3f orig_to_plane = m_normal * m_distance - orig;
             t0 = orig_to_plane * m_normal / denom;
-            return t0 >= 0;
+            return t0 >= t_min && t0 < t_max;
         }
         return false;
     }
 
+    void ray_intersect_packet(RayPacket& packet, int32_t id) const override {
+        OORT_STAT_ADD(PlaneTests, PACKET_SIZE);
+        packet_intersect_plane(packet, m_normal.x, m_normal.y, m_normal.z, m_distance, id);
+    }
+
     Vec3f get_position() const override { return m_normal * m_distance; }
     void set_position(const Vec3f& position) override { m_distance = position * m_normal; }
+    // Normale et distance à l'origine qui définissent le plan
+    Vec3f get_plane_normal() const { return m_normal; }
+    float get_distance() const { return m_distance; }
 
     Vec3f get_normal(const Vec3f& intersection_point) const override {
         if( (intersection_point + m_normal).norm() <= (intersection_point + Vec3f(0,0,0)).norm() ) return m_normal ;
         else return -m_normal;
     }
 
+    // Un plan est infini : sa boîte couvre tout l'espace et il est testé hors de la BVH
+    AABB get_bounds() const override {
+        const float inf = std::numeric_limits<float>::infinity();
+        return AABB(Vec3f(-inf, -inf, -inf), Vec3f(inf, inf, inf));
+    }
+    bool is_bounded() const override { return false; }
+
 
 private:
     Vec3f m_normal;
@@ -38,11 +57,11 @@ private:
 class CheckerboardPlane : public Plane {
 public:
     CheckerboardPlane(Vec3f normal, float distance,
-                      Material material1, Material material2,
+                      MaterialId material1, MaterialId material2,
                       float size)
         : Plane(normal, distance, material1), m_material1(material1), m_material2(material2), m_size(size) {}
 
-    Material get_material(const Vec3f& intersection_point) const override {
+    MaterialId get_material_id(const Vec3f& intersection_point) const override {
         int x = static_cast<int>(std::floor(intersection_point.x / m_size));
         int y = static_cast<int>(std::floor(intersection_point.y / m_size));
         int z = static_cast<int>(std::floor(intersection_point.z / m_size));
@@ -52,10 +71,12 @@ public:
             return m_material2;
         }
     }
+    MaterialId get_material1() const { return m_material1; }
+    MaterialId get_material2() const { return m_material2; }
 
 private:
-    Material m_material1;
-    Material m_material2;
+    MaterialId m_material1;
+    MaterialId m_material2;
     float m_size;
 };
 
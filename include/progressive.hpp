@@ -0,0 +1,127 @@
+#ifndef __PROGRESSIVE_HPP__
+#define __PROGRESSIVE_HPP__
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "tiles.hpp"
+#include "vectors.hpp"
+
+// État d'un rendu progressif : l'image partielle et le nombre de passes terminées pour chaque tuile.
+// La passe p calcule un pixel sur (coarse_step >> p) dans chaque direction et recopie sa couleur
+// sur le bloc qu'il représente ; la dernière passe calcule les pixels restants un par un.
+// L'état peut être écrit sur disque et relu pour reprendre un rendu interrompu.
+class RenderProgress {
+public:
+    // shading résume les options qui changent la couleur des pixels et scene le contenu de la scène :
+    // un point de reprise n'est relu que pour les mêmes empreintes
+    RenderProgress(int width, int height, double fov, int tile_size, TileOrder order, int coarse_step,
+                   size_t tile_count, uint32_t shading, uint32_t scene)
+        : m_width(width), m_height(height), m_tile_size(tile_size), m_tile_order(static_cast<uint32_t>(order)),
+          m_coarse_step(coarse_step), m_shading(shading), m_scene(scene),
+          m_framebuffer(static_cast<size_t>(height)*width), m_passes_done(tile_count, 0) {
+        std::memcpy(m_fov, &fov, sizeof(m_fov));
+        m_pass_count = 1;
+        while ((coarse_step >> m_pass_count) > 0) m_pass_count++;
+    }
+
+    std::vector<Vec3f>& get_framebuffer() { return m_framebuffer; }
+    const std::vector<Vec3f>& get_framebuffer() const { return m_framebuffer; }
+
+    // Nombre de passes, de l'échantillonnage grossier jusqu'à un rayon par pixel
+    int get_pass_count() const { return m_pass_count; }
+    // Écart entre deux pixels calculés pendant la passe
+    int get_pass_step(int pass) const { return m_coarse_step >> pass; }
+
+    size_t get_tile_count() const { return m_passes_done.size(); }
+    int get_passes_done(size_t tile) const { return m_passes_done[tile]; }
+    void set_passes_done(size_t tile, int passes) { m_passes_done[tile] = static_cast<uint8_t>(passes); }
+
+    // Première passe que toutes les tuiles n'ont pas encore terminée
+    int get_current_pass() const {
+        int pass = m_pass_count;
+        for (uint8_t done : m_passes_done) pass = std::min(pass, static_cast<int>(done));
+        return pass;
+    }
+    bool is_complete() const { return get_current_pass() == m_pass_count; }
+
+    // Écrit l'état dans un fichier temporaire renommé ensuite, pour qu'une interruption pendant
+    // l'écriture laisse le point de reprise précédent intact
+    bool save(const std::string& filename) const {
+        std::string temporary = filename + ".tmp";
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file) return false;
+        file.write(magic(), MAGIC_SIZE);
+        uint32_t header[HEADER_SIZE];
+        fill_header(header);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_passes_done.data()), m_passes_done.size());
+        std::vector<float> pixels(3*m_framebuffer.size());
+        for (size_t i = 0; i < m_framebuffer.size(); i++) {
+            for (size_t c = 0; c < 3; c++) pixels[3*i + c] = m_framebuffer[i][c];
+        }
+        file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size()*sizeof(float));
+        file.close();
+        if (!file) return false;
+        return std::rename(temporary.c_str(), filename.c_str()) == 0;
+    }
+
+    // Relit un point de reprise. Faux si le fichier n'existe pas ou s'il a été écrit pour un autre rendu
+    // (dimensions, angle de vue, découpage, options d'éclairage ou scène différents) ; l'état n'est alors pas modifié.
+    bool load(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) return false;
+        char file_magic[MAGIC_SIZE];
+        uint32_t header[HEADER_SIZE], expected[HEADER_SIZE];
+        fill_header(expected);
+        file.read(file_magic, MAGIC_SIZE);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || std::memcmp(file_magic, magic(), MAGIC_SIZE) != 0 || std::memcmp(header, expected, sizeof(header)) != 0) {
+            return false;
+        }
+        std::vector<uint8_t> passes_done(m_passes_done.size());
+        std::vector<float> pixels(3*m_framebuffer.size());
+        file.read(reinterpret_cast<char*>(passes_done.data()), passes_done.size());
+        file.read(reinterpret_cast<char*>(pixels.data()), pixels.size()*sizeof(float));
+        if (!file) return false;
+        m_passes_done = passes_done;
+        for (size_t i = 0; i < m_framebuffer.size(); i++) {
+            m_framebuffer[i] = Vec3f(pixels[3*i], pixels[3*i + 1], pixels[3*i + 2]);
+        }
+        return true;
+    }
+
+private:
+    static const size_t MAGIC_SIZE = 8;
+    static const char* magic() { return "OORTCKP2"; }
+    static const int HEADER_SIZE = 10;
+
+    void fill_header(uint32_t header[HEADER_SIZE]) const {
+        header[0] = m_width;
+        header[1] = m_height;
+        header[2] = m_fov[0];
+        header[3] = m_fov[1];
+        header[4] = m_tile_size;
+        header[5] = m_tile_order;
+        header[6] = m_coarse_step;
+        header[7] = static_cast<uint32_t>(m_passes_done.size());
+        header[8] = m_shading;
+        header[9] = m_scene;
+    }
+
+    uint32_t m_width, m_height;
+    uint32_t m_fov[2]; // bits de l'angle de vue (double)
+    uint32_t m_tile_size, m_tile_order;
+    uint32_t m_coarse_step;
+    uint32_t m_shading; // empreinte des options d'éclairage
+    uint32_t m_scene;   // empreinte de la géométrie, des matériaux et des lumières
+    int m_pass_count;
+    std::vector<Vec3f> m_framebuffer;
+    std::vector<uint8_t> m_passes_done;
+};
+
+
+#endif
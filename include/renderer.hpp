@@ -0,0 +1,81 @@
+#ifndef __RENDERER_HPP__
+#define __RENDERER_HPP__
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "scene.hpp"
+#include "tiles.hpp"
+#include "image_writer.hpp"
+#include "vectors.hpp"
+
+// Lancer de rayons : rayons primaires, ombres, réflexions et réfractions (voir renderer.cpp)
+
+// Distance au-delà de laquelle on considère qu'un rayon ne touche plus rien
+const float MAX_RAY_DISTANCE = 1000.f;
+
+// Modèle d'éclairage. Avec None seule la composante diffuse est gardée, sans rayons secondaires.
+enum class ShadingModel { None, Phong, BlinnPhong };
+
+// Paramètres du lancer de rayons
+struct RenderOptions {
+    size_t max_depth = 4;     // profondeur maximale des rayons réfléchis et réfractés
+    float min_weight = 0.f;   // une branche dont la contribution ne dépasse pas ce seuil n'est pas lancée
+    int width = 1024;         // dimensions de l'image en pixels
+    int height = 768;
+    double fov = 1.;          // angle de vue vertical en radians (environ 57°)
+    std::string output = "./images/out.ppm"; // "-" pour la sortie standard
+    std::string format;       // "ppm" ou "pfm", vide = d'après l'extension de output
+    bool packets = false;     // rayons primaires lancés par paquets de PACKET_SIZE
+    int tile_size = 32;       // côté des tuiles distribuées aux threads, en pixels
+    TileOrder tile_order = TileOrder::Morton;
+    bool thread_report = false; // affiche le temps de calcul de chaque thread après le rendu
+    int coarse_step = 1;      // écart entre les pixels de la première passe (puissance de 2, 1 = pas de rendu progressif)
+    double time_budget = 0.;  // durée maximale du rendu en secondes, 0 = illimitée
+    std::string checkpoint;   // fichier du point de reprise, vide = pas de point de reprise
+    double checkpoint_interval = 30.; // secondes entre deux écritures du point de reprise
+    int aa_samples = 0;       // rayons par pixel suréchantillonné (arrondi à un carré), 0 = pas d'anticrénelage
+    float aa_threshold = 0.1f; // écart de couleur entre voisins au-delà duquel un pixel est suréchantillonné
+    float aa_budget = 0.25f;  // proportion maximale de pixels suréchantillonnés
+    int workers = 0;          // processus de rendu (voir distributed.hpp), 0 = threads OpenMP de ce processus
+    std::string heatmap;      // "time" ou "rays" : carte du coût de chaque pixel, écrite à côté de l'image (OORT_STATS)
+    ShadingModel shading = ShadingModel::Phong;
+    int light_samples = 0;    // lumières tirées par intersection parmi celles qui l'atteignent, 0 = toutes
+    int stream_window = 0;    // bandes de tile_size lignes gardées en mémoire, écrites au fil du rendu, 0 = image entière
+    std::string gbuffer;      // fichier du G-buffer, relu ou écrit pour éviter les rayons primaires, vide = pas de G-buffer
+    bool tile_lists = false;  // rayons primaires testés contre les seuls objets vus par leur tuile (voir tile_lists.hpp)
+    bool fast_shading = false; // éclairage avec les noyaux approchés de fast_math.hpp, écart mesuré par bench/shading_error.cpp
+};
+
+// "phong", "blinn-phong" ou "none". Faux si le nom est inconnu.
+bool parse_shading_model(const std::string &name, ShadingModel &model);
+
+bool scene_intersect(const Vec3f &orig, const Vec3f &dir, const Scene &scene, Hit &hit);
+
+Vec3f reflect(const Vec3f &I, const Vec3f &N);
+
+// Loi de Snell ; rend le vecteur nul en cas de réflexion totale
+Vec3f refract(const Vec3f &I, const Vec3f &N, const float &refractive_index);
+
+// Couleur vue le long du rayon avec le modèle d'éclairage options.shading.
+// primary_hit permet de fournir l'intersection du premier rayon quand elle a déjà été calculée (paquets de rayons)
+Vec3f cast_ray(const Vec3f &orig, const Vec3f &dir, const Scene &scene, const RenderOptions &options,
+               const Hit *primary_hit = nullptr);
+
+// Direction du rayon primaire qui passe par le point (i + dx, j + dy) de l'image, le centre du pixel par défaut
+Vec3f primary_ray_dir(int i, int j, int width, int height, double tan_half_fov, double dx = 0.5, double dy = 0.5);
+
+// Rend l'image décrite par options et la confie à writer. Faux si l'image n'a pas pu être rendue.
+bool render(const Scene &scene, const RenderOptions &options, ImageWriter &writer);
+
+// Rend la tuile dans framebuffer, sur le thread appelant. framebuffer ne contient que les lignes de la tuile,
+// sur toute la largeur de l'image : il est redimensionné à options.width x (tile.y1 - tile.y0).
+void render_region(const Scene &scene, const RenderOptions &options, const Tile &tile,
+                   std::vector<Vec3f> &framebuffer);
+
+// Rend les tuiles dans framebuffer, réparties entre les threads, en une passe et sans anticrénelage.
+// Les autres pixels ne sont pas modifiés.
+void render_tiles(const Scene &scene, const RenderOptions &options, const std::vector<Tile> &tiles,
+                  std::vector<Vec3f> &framebuffer);
+
+
+#endif
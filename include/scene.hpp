@@ -0,0 +1,255 @@
+#ifndef __SCENE_HPP__
+#define __SCENE_HPP__
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include "object.hpp"
+#include "material.hpp"
+#include "light.hpp"
+#include "light_tree.hpp"
+#include "aabb.hpp"
+#include "bvh.hpp"
+#include "packet.hpp"
+#include "compiled_scene.hpp"
+#include "stats.hpp"
+#include "vectors.hpp"
+
+// Méthode utilisée pour trouver l'objet touché par un rayon
+enum class Accelerator {
+    Linear,   // on teste tous les objets un par un
+    BVH,      // on parcourt la hiérarchie de volumes englobants
+    Compiled  // on teste les tableaux de primitives de la scène compilée avec les noyaux vectoriels
+};
+
+// Enregistrement d'intersection gardé pendant le parcours : seulement la distance et l'objet touché.
+// Le point, la normale et le matériau sont calculés une seule fois, pour l'objet retenu.
+struct Hit {
+    float t;          // distance le long du rayon
+    uint32_t object;  // indice de l'objet dans Scene::get_objects()
+};
+
+// Scène : objets, lumières et structure d'accélération construite une fois à partir des objets
+class Scene {
+public:
+    Scene() : m_accelerator(Accelerator::BVH), m_built_area(0.), m_lights_moved(false) {}
+    ~Scene() {
+        for (Object* object : m_objects) delete object;
+        for (Object* prototype : m_prototypes) delete prototype;
+    }
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // La scène devient propriétaire de l'objet
+    void add_object(Object* object) { m_objects.push_back(object); }
+    void add_light(const Light& light) { m_lights.push_back(light); }
+    // Objet partagé par des instances (voir instance.hpp) : la scène en devient propriétaire,
+    // mais il n'est pas rendu lui-même
+    const Object* add_prototype(Object* prototype) {
+        m_prototypes.push_back(prototype);
+        return prototype;
+    }
+
+    // Déplace un objet. La structure d'accélération n'est mise à jour qu'à l'appel de refit().
+    void set_object_position(size_t index, const Vec3f& position) {
+        m_objects[index]->set_position(position);
+        m_moved.push_back(static_cast<uint32_t>(index));
+    }
+    void set_light_position(size_t index, const Vec3f& position) {
+        m_lights[index].position = position;
+        m_lights_moved = true;
+    }
+
+    const std::vector<Object*>& get_objects() const { return m_objects; }
+    const std::vector<Light>& get_lights() const { return m_lights; }
+    const std::vector<Object*>& get_prototypes() const { return m_prototypes; }
+    // Lumières qui éclairent un point, construit par build() avec la structure d'accélération
+    const LightTree& get_light_tree() const { return m_light_tree; }
+
+    // Les objets ne référencent leur matériau que par son indice dans cette table
+    MaterialLibrary& get_materials() { return m_materials; }
+    const MaterialLibrary& get_materials() const { return m_materials; }
+
+    Accelerator get_accelerator() const { return m_accelerator; }
+    void set_accelerator(Accelerator accelerator) { m_accelerator = accelerator; }
+
+    // Prépare la structure d'accélération choisie. La BVH est construite à partir des objets bornés ;
+    // les plans, infinis, sont gardés à part et testés à chaque rayon.
+    void build() {
+        OORT_PHASE_TIMER(Build);
+        m_moved.clear();
+        m_light_tree.build(m_lights);
+        m_lights_moved = false;
+        if (m_accelerator == Accelerator::Compiled) {
+            m_compiled.compile(m_objects);
+            return;
+        }
+        m_unbounded.clear();
+        std::vector<AABB> bounds;
+        std::vector<size_t> bounded;
+        for (size_t i = 0; i < m_objects.size(); i++) {
+            if (m_objects[i]->is_bounded()) {
+                AABB box = m_objects[i]->get_bounds();
+                // Petite marge pour que les rayons rasants ne ratent pas la boîte par erreur d'arrondi
+                box.pad(BOUNDS_EPSILON);
+                bounds.push_back(box);
+                bounded.push_back(i);
+            } else {
+                m_unbounded.push_back(i);
+            }
+        }
+        m_bvh.build(bounds);
+
+        // Les objets sont recopiés dans l'ordre des feuilles pour que le parcours lise une mémoire contiguë
+        m_bvh_objects.resize(bounded.size());
+        m_bvh_ids.resize(bounded.size());
+        m_bvh_slots.assign(m_objects.size(), NOT_IN_BVH);
+        for (size_t slot = 0; slot < bounded.size(); slot++) {
+            m_bvh_ids[slot] = static_cast<uint32_t>(bounded[m_bvh.primitive_index(slot)]);
+            m_bvh_objects[slot] = m_objects[m_bvh_ids[slot]];
+            m_bvh_slots[m_bvh_ids[slot]] = static_cast<uint32_t>(slot);
+        }
+        m_built_area = m_bvh.total_area();
+    }
+
+    // Met à jour la structure d'accélération après des déplacements d'objets, sans la reconstruire :
+    // seules les boîtes des objets déplacés et de leurs ancêtres dans la BVH sont recalculées.
+    // Les objets restent dans les feuilles choisies à la construction ; si les boîtes ont trop grossi
+    // depuis (objets éloignés de leurs voisins d'origine), la BVH est reconstruite.
+    // Les lumières, peu nombreuses par rapport aux objets, sont simplement rangées à nouveau.
+    void refit() {
+        if (m_lights_moved) {
+            OORT_PHASE_TIMER(Build);
+            m_light_tree.build(m_lights);
+            m_lights_moved = false;
+        }
+        if (m_moved.empty()) return;
+        {
+            OORT_PHASE_TIMER(Build);
+            if (m_accelerator == Accelerator::Compiled) {
+                m_compiled.update(m_objects, m_moved);
+            } else if (m_accelerator == Accelerator::BVH) {
+                std::vector<uint32_t> slots;
+                for (uint32_t i : m_moved) {
+                    if (m_bvh_slots[i] != NOT_IN_BVH) slots.push_back(m_bvh_slots[i]);
+                }
+                m_bvh.refit(slots, [&](uint32_t slot) {
+                    AABB box = m_bvh_objects[slot]->get_bounds();
+                    box.pad(BOUNDS_EPSILON);
+                    return box;
+                });
+            }
+            m_moved.clear();
+        }
+        if (m_accelerator == Accelerator::BVH && m_bvh.total_area() > REBUILD_RATIO*m_built_area) build();
+    }
+
+    // Cherche l'objet le plus proche touché par le rayon et remplit hit en cas de succès
+    bool intersect(const Vec3f& orig, const Vec3f& dir, Hit& hit) const {
+        float closest_dist = std::numeric_limits<float>::max();
+        uint32_t object = 0;
+        bool found = false;
+
+        if (m_accelerator == Accelerator::Compiled) {
+            found = m_compiled.intersect(orig, dir, 0.f, closest_dist, object);
+        } else if (m_accelerator == Accelerator::Linear) {
+            for (size_t i = 0; i < m_objects.size(); i++) {
+                float dist_i;
+                if (m_objects[i]->ray_intersect(orig, dir, dist_i, 0.f, closest_dist)) {
+                    closest_dist = dist_i;
+                    object = static_cast<uint32_t>(i);
+                    found = true;
+                }
+            }
+        } else {
+            for (size_t i : m_unbounded) {
+                float dist_i;
+                if (m_objects[i]->ray_intersect(orig, dir, dist_i, 0.f, closest_dist)) {
+                    closest_dist = dist_i;
+                    object = static_cast<uint32_t>(i);
+                    found = true;
+                }
+            }
+            m_bvh.intersect(orig, dir, 0.f, closest_dist, [&](size_t slot, float tmin, float& tmax) {
+                float dist_i;
+                if (m_bvh_objects[slot]->ray_intersect(orig, dir, dist_i, tmin, tmax)) {
+                    tmax = dist_i;
+                    object = m_bvh_ids[slot];
+                    found = true;
+                }
+            });
+        }
+
+        hit.t = closest_dist;
+        hit.object = object;
+        return found;
+    }
+
+    // Cherche pour chaque rayon du paquet l'objet le plus proche touché. Les rayons doivent être
+    // initialisés avec t à la distance maximale et object à PACKET_NO_HIT.
+    void intersect_packet(RayPacket& packet) const {
+        if (m_accelerator == Accelerator::Compiled) {
+            m_compiled.intersect_packet(packet);
+            return;
+        }
+        if (m_accelerator == Accelerator::Linear) {
+            for (size_t i = 0; i < m_objects.size(); i++) {
+                m_objects[i]->ray_intersect_packet(packet, static_cast<int32_t>(i));
+            }
+            return;
+        }
+        for (size_t i : m_unbounded) {
+            m_objects[i]->ray_intersect_packet(packet, static_cast<int32_t>(i));
+        }
+        m_bvh.intersect_packet(packet, [&](size_t slot) {
+            m_bvh_objects[slot]->ray_intersect_packet(packet, static_cast<int32_t>(m_bvh_ids[slot]));
+        });
+    }
+
+    // Test d'occultation : vrai dès qu'un objet coupe le rayon à une distance dans [tmin, tmax).
+    // Contrairement à intersect, on ne cherche pas l'obstacle le plus proche.
+    bool occluded(const Vec3f& orig, const Vec3f& dir, float tmin, float tmax) const {
+        float dist;
+        if (m_accelerator == Accelerator::Compiled) {
+            return m_compiled.occluded(orig, dir, tmin, tmax);
+        }
+        if (m_accelerator == Accelerator::Linear) {
+            for (const Object* object : m_objects) {
+                if (object->ray_intersect(orig, dir, dist, tmin, tmax)) return true;
+            }
+            return false;
+        }
+        for (size_t i : m_unbounded) {
+            if (m_objects[i]->ray_intersect(orig, dir, dist, tmin, tmax)) return true;
+        }
+        return m_bvh.occluded(orig, dir, tmin, tmax, [&](size_t slot, float t0, float t1) {
+            return m_bvh_objects[slot]->ray_intersect(orig, dir, dist, t0, t1);
+        });
+    }
+
+private:
+    static constexpr float BOUNDS_EPSILON = 1e-4f;
+    // Croissance de la somme des aires des boîtes au-delà de laquelle refit() reconstruit la BVH
+    static constexpr double REBUILD_RATIO = 2.;
+    static constexpr uint32_t NOT_IN_BVH = std::numeric_limits<uint32_t>::max();
+
+    std::vector<Object*> m_objects;
+    std::vector<Light> m_lights;
+    std::vector<Object*> m_prototypes;
+    MaterialLibrary m_materials;
+    Accelerator m_accelerator;
+
+    CompiledScene m_compiled;
+    BVH m_bvh;
+    std::vector<size_t> m_unbounded;          // indices des objets infinis
+    std::vector<const Object*> m_bvh_objects; // objets bornés dans l'ordre des feuilles de la BVH
+    std::vector<uint32_t> m_bvh_ids;          // indice dans m_objects de chaque entrée de m_bvh_objects
+    std::vector<uint32_t> m_bvh_slots;        // position dans m_bvh_objects de chaque objet (NOT_IN_BVH sinon)
+    double m_built_area;                      // somme des aires des boîtes de la BVH à sa construction
+    std::vector<uint32_t> m_moved;            // objets déplacés depuis la dernière mise à jour
+    LightTree m_light_tree;
+    bool m_lights_moved;                      // lumières déplacées depuis la dernière mise à jour
+};
+
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __SCENE_DESCRIPTION_HPP__
+#define __SCENE_DESCRIPTION_HPP__
+#include <vector>
+#include <cstdint>
+#include "scene.hpp"
+
+// Descriptions des objets d'une scène (voir scene_description.cpp), comparées d'un chargement à l'autre
+// par le mode surveillance et résumées en empreintes pour les fichiers relus par un rendu suivant.
+
+// Matériaux que peut montrer l'objet, y compris ceux des prototypes et des groupes
+void collect_materials(const Object* object, std::vector<MaterialId>& materials);
+
+// Description d'un objet : deux objets de même description donnent la même image. Elle comprend la
+// géométrie, les matériaux et, pour un maillage, une empreinte de ses sommets, normales et indices.
+void describe_object(const Object* object, std::vector<float>& out);
+
+// Empreinte des descriptions de tous les objets, dans l'ordre de la scène
+uint32_t geometry_fingerprint(const Scene& scene);
+
+// Empreinte de tout ce que l'image montre de la scène : géométrie, paramètres des matériaux et lumières
+uint32_t scene_fingerprint(const Scene& scene);
+
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __SCENE_IO_HPP__
+#define __SCENE_IO_HPP__
+#include <string>
+#include "scene.hpp"
+#include "animation.hpp"
+#include "mesh.hpp"
+
+// Lecture et écriture des descriptions de scène (voir scene_io.cpp).
+// Les objets et lumières lus sont ajoutés à la scène ; les matériaux sont cherchés par leur nom
+// dans sa MaterialLibrary. Chaque fonction rend faux et écrit l'erreur sur std::cerr en cas d'échec.
+
+// Matériaux connus des fichiers de configuration : ivory, red_rubber, mirror, glass, blue_metal et grey_metal
+void add_default_materials(MaterialLibrary& materials);
+
+// Fichier de configuration texte, une ligne par objet ou lumière, champs séparés par ';'.
+// Un objet dont le dernier champ nomme un prototype en fait partie au lieu d'être ajouté à la scène ;
+// une ligne Instance place une copie du prototype nommé (échelle dans le champ des dimensions, angles,
+// matériau facultatif qui remplace ceux du prototype). Un prototype est figé à sa première instance.
+// Une ligne Mesh lit le fichier OBJ donné dans le champ du rayon et le place au centre indiqué.
+// Pour une ligne Lights, le champ du rayon est le rayon d'influence de la lumière (None : infini).
+bool load_csv(const std::string& filename, Scene& scene);
+
+// Maillage de triangles lu dans un fichier OBJ (sommets, normales et faces), avec un seul matériau.
+// Le nombre de triangles, la mémoire par triangle et les temps de lecture et de construction de la BVH
+// sont affichés. Rend nullptr en cas d'échec.
+TriangleMesh* load_obj(const std::string& filename, MaterialId material);
+
+// Format binaire : tables de matériaux et d'enregistrements de taille fixe, relues sans analyse de texte.
+// Seuls les sphères, les parallélépipèdes et les lumières sont enregistrés.
+bool save_scene_binary(const std::string& filename, const Scene& scene);
+bool load_scene_binary(const std::string& filename, Scene& scene);
+
+// Reconnaît le format binaire à sa signature, sinon lit le fichier comme un fichier de configuration
+bool load_scene(const std::string& filename, Scene& scene);
+
+// Fichier d'animation, une trajectoire par ligne, champs séparés par ';' :
+//   Key; Object|Lights; numéro; image; (x, y, z);       position à une image donnée
+//   Orbit; Object|Lights; numéro; ; (x, y, z); tours   rotation autour de l'axe vertical passant par (x, y, z)
+bool load_animation(const std::string& filename, Animation& animation);
+
+
+#endif
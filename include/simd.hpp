@@ -0,0 +1,21 @@
+#ifndef __SIMD_HPP__
+#define __SIMD_HPP__
+
+// Outils communs aux noyaux vectoriels (packet.cpp, compiled_scene.cpp).
+// Les boucles des noyaux sont écrites sans branchement (& plutôt que &&, sélections ?:) pour que le
+// compilateur puisse les vectoriser (voir les options de ces fichiers dans le makefile).
+// Chaque noyau est compilé en trois versions (AVX-512, AVX2 et x86-64 de base) ; le chargeur choisit
+// la bonne au démarrage selon le processeur, ce qui permet d'utiliser le même exécutable sur toutes les machines.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define OORT_MULTIVERSION __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define OORT_MULTIVERSION
+#endif
+
+// Minimum et maximum par valeur, mêmes résultats que std::min et std::max, mais que le compilateur
+// transforme en sélections vectorielles
+static inline float lane_min(float a, float b) { return b < a ? b : a; }
+static inline float lane_max(float a, float b) { return a < b ? b : a; }
+
+
+#endif
@@ -1,34 +1,48 @@
 #ifndef __SPHERE_HPP__
 #define __SPHERE_HPP__
 #include "object.hpp"
+#include "stats.hpp"
 #include "vectors.hpp"
 
 class Sphere : public Object {
 public:
-    Sphere(Vec3f center, float radius, Material material) 
+    Sphere(Vec3f center, float radius, MaterialId material) 
         : Object(material), center(center), radius(radius) {}
 
     // Méthode pour calculer l'intersection d'un rayon avec la sphère
-    bool ray_intersect(const Vec3f &orig, const Vec3f &dir, float &t0) const override {
+    bool ray_intersect(const Vec3f &orig, const Vec3f &dir, float &t0,
+                       float t_min = 0.f, float t_max = std::numeric_limits<float>::max()) const override {
+        OORT_STAT(SphereTests);
         Vec3f L = center - orig;
         float tca = L*dir;
         float d2 = L*L - tca*tca;
         if (d2 > radius*radius) return false;
         float thc = sqrtf(radius*radius - d2);
         t0       = tca - thc;
+        if (t0 >= t_max) return false;
         float t1 = tca + thc;
-        if (t0 < 0) t0 = t1;
-        if (t0 < 0) return false;
+        if (t0 < t_min) t0 = t1;
+        if (t0 < t_min || t0 >= t_max) return false;
         return true;
     }
 
+    void ray_intersect_packet(RayPacket& packet, int32_t id) const override {
+        OORT_STAT_ADD(SphereTests, PACKET_SIZE);
+        packet_intersect_sphere(packet, center.x, center.y, center.z, radius, id);
+    }
+
     Vec3f get_position() const override { return center; }
     void set_position(const Vec3f& position) override { center = position; }
+    float get_radius() const { return radius; }
 
     Vec3f get_normal(const Vec3f& point) const override {
         return (point - center).normalize();
     }
 
+    AABB get_bounds() const override {
+        return AABB(center - Vec3f(radius, radius, radius), center + Vec3f(radius, radius, radius));
+    }
+
 private:
     Vec3f center;
     float radius;
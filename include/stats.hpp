@@ -0,0 +1,172 @@
+#ifndef __STATS_HPP__
+#define __STATS_HPP__
+
+// Statistiques de rendu : nombre de rayons de chaque sorte, tests d'intersection par type de primitive,
+// profondeur atteinte par les rayons et temps passé dans chaque phase (lecture, construction, rendu, écriture).
+// Elles ne sont compilées qu'avec -DOORT_STATS (make STATS=1) ; sinon les macros OORT_STAT* et
+// OORT_PHASE_TIMER ne produisent aucun code.
+//
+// Chaque thread compte dans ses propres compteurs, sans synchronisation. Les compteurs de tous les threads
+// sont additionnés à la demande (stats_totals), une fois les threads de rendu arrêtés.
+
+#ifdef OORT_STATS
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <chrono>
+#include "vectors.hpp"
+
+enum class Stat {
+    PrimaryRays,
+    ReflectionRays,
+    RefractionRays,
+    ShadowRays,
+    SphereTests,
+    ParallelepipedTests,
+    PlaneTests,
+    TriangleTests, // triangles des maillages
+    OtherTests,  // objets sans noyau dédié, testés par appel virtuel dans la scène compilée
+    BoxTests,    // boîtes de la BVH
+    Count
+};
+const size_t STAT_COUNT = static_cast<size_t>(Stat::Count);
+
+enum class Phase { Parse, Build, Trace, Output, Count };
+const size_t PHASE_COUNT = static_cast<size_t>(Phase::Count);
+
+// Profondeurs distinguées dans l'histogramme ; les rayons plus profonds sont comptés dans la dernière case
+const size_t STATS_DEPTH_BINS = 64;
+
+struct StatsCounters {
+    uint64_t counters[STAT_COUNT] = {};
+    uint64_t depth[STATS_DEPTH_BINS] = {}; // rayons tracés à chaque profondeur (0 = rayon primaire)
+
+    uint64_t get(Stat stat) const { return counters[static_cast<size_t>(stat)]; }
+
+    uint64_t rays() const {
+        return get(Stat::PrimaryRays) + get(Stat::ReflectionRays) + get(Stat::RefractionRays) + get(Stat::ShadowRays);
+    }
+
+    StatsCounters& operator+=(const StatsCounters& other) {
+        for (size_t i = 0; i < STAT_COUNT; i++) counters[i] += other.counters[i];
+        for (size_t i = 0; i < STATS_DEPTH_BINS; i++) depth[i] += other.depth[i];
+        return *this;
+    }
+};
+
+class ThreadStats;
+
+// État partagé : les compteurs de chaque thread vivant, ceux des threads terminés et les temps des phases
+struct StatsRegistry {
+    std::mutex mutex;
+    std::vector<const ThreadStats*> threads;
+    StatsCounters finished;
+    double phases[PHASE_COUNT] = {};
+};
+
+inline StatsRegistry& stats_registry() {
+    static StatsRegistry registry;
+    return registry;
+}
+
+// Compteurs d'un thread, enregistrés à sa première mesure. À la fin du thread, ils sont ajoutés
+// à ceux des threads terminés.
+class ThreadStats {
+public:
+    ThreadStats() {
+        StatsRegistry& registry = stats_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.push_back(this);
+    }
+
+    ~ThreadStats() {
+        StatsRegistry& registry = stats_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.finished += m_counters;
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+    }
+
+    ThreadStats(const ThreadStats&) = delete;
+    ThreadStats& operator=(const ThreadStats&) = delete;
+
+    void add(Stat stat, uint64_t n) { m_counters.counters[static_cast<size_t>(stat)] += n; }
+    void record_depth(size_t depth) { m_counters.depth[std::min(depth, STATS_DEPTH_BINS - 1)]++; }
+    const StatsCounters& get_counters() const { return m_counters; }
+
+private:
+    StatsCounters m_counters;
+};
+
+inline ThreadStats& thread_stats() {
+    static thread_local ThreadStats stats;
+    return stats;
+}
+
+// Compteurs de chaque thread vivant, un élément par thread
+inline std::vector<StatsCounters> stats_per_thread() {
+    StatsRegistry& registry = stats_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<StatsCounters> counters;
+    for (const ThreadStats* stats : registry.threads) counters.push_back(stats->get_counters());
+    return counters;
+}
+
+// Total des compteurs de tous les threads, y compris ceux déjà terminés
+inline StatsCounters stats_totals() {
+    StatsRegistry& registry = stats_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    StatsCounters total = registry.finished;
+    for (const ThreadStats* stats : registry.threads) total += stats->get_counters();
+    return total;
+}
+
+inline void stats_add_phase(Phase phase, double seconds) {
+    StatsRegistry& registry = stats_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.phases[static_cast<size_t>(phase)] += seconds;
+}
+
+// Ajoute au temps de la phase la durée de vie de l'objet
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase) : m_phase(phase), m_start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+        stats_add_phase(m_phase, elapsed.count());
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    Phase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Écrit les compteurs et les temps des phases en JSON (voir stats.cpp)
+bool write_stats_json(const std::string& filename);
+
+// Carte de coût : fichier écrit à côté de l'image (out.ppm donne out_cost.ppm) et couleurs,
+// du noir (coût nul) au blanc (99e centile des coûts de l'image) en passant par le bleu, le rouge et le jaune
+std::string heatmap_filename(const std::string& output);
+std::vector<Vec3f> cost_heatmap(const std::vector<float>& cost);
+
+#define OORT_STAT_ADD(stat, n) thread_stats().add(Stat::stat, (n))
+#define OORT_STAT(stat) OORT_STAT_ADD(stat, 1)
+#define OORT_STAT_DEPTH(depth) thread_stats().record_depth(depth)
+#define OORT_PHASE_TIMER(phase) PhaseTimer oort_phase_timer(Phase::phase)
+
+#else
+
+#define OORT_STAT_ADD(stat, n) ((void)0)
+#define OORT_STAT(stat) ((void)0)
+#define OORT_STAT_DEPTH(depth) ((void)0)
+#define OORT_PHASE_TIMER(phase) ((void)0)
+
+#endif
+
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef __TILE_LISTS_HPP__
+#define __TILE_LISTS_HPP__
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "scene.hpp"
+#include "tiles.hpp"
+#include "packet.hpp"
+#include "stats.hpp"
+#include "vectors.hpp"
+
+// Objets que peuvent toucher les rayons primaires de chaque tuile. Tous partent de la caméra, à l'origine :
+// un rayon ne peut toucher un objet borné que si son pixel est dans l'image à l'écran de sa boîte
+// englobante, le rectangle qui contient ses huit coins projetés. Chaque objet n'est rangé que dans les
+// tuiles que recouvre ce rectangle, agrandi d'un pixel pour les erreurs d'arrondi ; les plans, infinis,
+// sont dans toutes les listes. Dans une scène clairsemée, les rayons d'une tuile ne testent ainsi que les
+// quelques objets qu'elle voit, sans parcourir la BVH. Les tuiles qui voient trop d'objets gardent la
+// structure d'accélération de la scène.
+class TileObjectLists {
+public:
+    // Au-delà de cette taille la liste d'une tuile n'est pas utilisée : le parcours de la BVH coûte moins
+    static const uint32_t MAX_LIST_SIZE = 16;
+
+    // Grille des tuiles de tile_size pixels de côté, comme celle de TileScheduler
+    void build(const Scene& scene, int width, int height, int tile_size, double tan_half_fov) {
+        OORT_PHASE_TIMER(Build);
+        m_tile_size = std::max(1, tile_size);
+        m_columns = (width + m_tile_size - 1) / m_tile_size;
+        const int rows = (height + m_tile_size - 1) / m_tile_size;
+        const std::vector<Object*>& objects = scene.get_objects();
+
+        // Tuiles [c0, c1] x [r0, r1] de chaque objet, puis listes rangées à la suite les unes des autres
+        std::vector<int> spans(4*objects.size());
+        std::vector<uint32_t> counts(m_columns*rows + 1, 0);
+        for (size_t i = 0; i < objects.size(); i++) {
+            int* span = &spans[4*i];
+            tile_span(objects[i], width, height, tan_half_fov, rows, span);
+            for (int r = span[2]; r <= span[3]; r++) {
+                for (int c = span[0]; c <= span[1]; c++) counts[r*m_columns + c + 1]++;
+            }
+        }
+        for (size_t cell = 1; cell < counts.size(); cell++) counts[cell] += counts[cell - 1];
+        m_offsets = counts;
+        m_objects.resize(m_offsets.back());
+        m_ids.resize(m_offsets.back());
+        // Les objets sont parcourus dans l'ordre : chaque liste les garde dans l'ordre de la scène
+        for (size_t i = 0; i < objects.size(); i++) {
+            const int* span = &spans[4*i];
+            for (int r = span[2]; r <= span[3]; r++) {
+                for (int c = span[0]; c <= span[1]; c++) {
+                    const uint32_t slot = counts[r*m_columns + c]++;
+                    m_objects[slot] = objects[i];
+                    m_ids[slot] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+
+    // Cherche l'objet le plus proche touché par un rayon primaire de la tuile (de la grille de build)
+    // et remplit hit comme Scene::intersect, dont le résultat est repris pour les tuiles trop chargées
+    bool intersect(const Scene& scene, const Tile& tile, const Vec3f& orig, const Vec3f& dir, Hit& hit) const {
+        const size_t cell = cell_of(tile);
+        const uint32_t begin = m_offsets[cell], end = m_offsets[cell + 1];
+        if (end - begin > MAX_LIST_SIZE) return scene.intersect(orig, dir, hit);
+
+        float closest_dist = std::numeric_limits<float>::max();
+        uint32_t object = 0;
+        bool found = false;
+        for (uint32_t slot = begin; slot < end; slot++) {
+            float dist_i;
+            if (m_objects[slot]->ray_intersect(orig, dir, dist_i, 0.f, closest_dist)) {
+                closest_dist = dist_i;
+                object = m_ids[slot];
+                found = true;
+            }
+        }
+        hit.t = closest_dist;
+        hit.object = object;
+        return found;
+    }
+
+    // Même recherche pour un paquet de rayons primaires de la tuile, initialisé comme pour Scene::intersect_packet
+    void intersect_packet(const Scene& scene, const Tile& tile, RayPacket& packet) const {
+        const size_t cell = cell_of(tile);
+        const uint32_t begin = m_offsets[cell], end = m_offsets[cell + 1];
+        if (end - begin > MAX_LIST_SIZE) {
+            scene.intersect_packet(packet);
+            return;
+        }
+        for (uint32_t slot = begin; slot < end; slot++) {
+            m_objects[slot]->ray_intersect_packet(packet, static_cast<int32_t>(m_ids[slot]));
+        }
+    }
+
+private:
+    // Profondeur minimale d'un coin projeté ; une boîte qui s'approche plus de la caméra est dans toutes les tuiles
+    static constexpr float NEAR_DEPTH = 1e-4f;
+    // Même marge que celle des boîtes de la BVH de la scène
+    static constexpr float BOUNDS_EPSILON = 1e-4f;
+
+    size_t cell_of(const Tile& tile) const {
+        return static_cast<size_t>(tile.y0 / m_tile_size)*m_columns + tile.x0 / m_tile_size;
+    }
+
+    // Colonnes span[0]..span[1] et lignes span[2]..span[3] des tuiles que peut voir l'objet (vide si span[0] > span[1])
+    void tile_span(const Object* object, int width, int height, double tan_half_fov, int rows, int span[4]) const {
+        span[0] = 0; span[1] = m_columns - 1;
+        span[2] = 0; span[3] = rows - 1;
+        if (!object->is_bounded()) return;
+        AABB box = object->get_bounds();
+        box.pad(BOUNDS_EPSILON);
+        const Vec3f lo = box.get_min(), hi = box.get_max();
+        // Les rayons primaires vont vers les z négatifs : une boîte derrière la caméra n'est vue par aucun
+        if (lo.z > 0.f) {
+            span[1] = -1;
+            return;
+        }
+        if (!(hi.z < -NEAR_DEPTH)) return;
+
+        // Pixel (i, j) dont le rayon primaire passe par le coin, inverse de primary_ray_dir
+        const float aspect = width/(float)height;
+        float i0 = std::numeric_limits<float>::max(), j0 = i0, i1 = -i0, j1 = -i0;
+        for (int k = 0; k < 8; k++) {
+            const Vec3f p(k & 1 ? hi.x : lo.x, k & 2 ? hi.y : lo.y, k & 4 ? hi.z : lo.z);
+            const float i = (p.x/-p.z/(tan_half_fov*aspect) + 1.f)*width/2.f - 0.5f;
+            const float j = (1.f - p.y/-p.z/tan_half_fov)*height/2.f - 0.5f;
+            i0 = std::min(i0, i); i1 = std::max(i1, i);
+            j0 = std::min(j0, j); j1 = std::max(j1, j);
+        }
+        if (i1 < -1.f || j1 < -1.f || i0 > width || j0 > height) {
+            span[1] = -1;
+            return;
+        }
+        span[0] = static_cast<int>(std::floor(std::max(i0 - 1.f, 0.f)))/m_tile_size;
+        span[1] = std::min(m_columns - 1, static_cast<int>(std::min(i1 + 1.f, (float)width))/m_tile_size);
+        span[2] = static_cast<int>(std::floor(std::max(j0 - 1.f, 0.f)))/m_tile_size;
+        span[3] = std::min(rows - 1, static_cast<int>(std::min(j1 + 1.f, (float)height))/m_tile_size);
+    }
+
+    int m_tile_size = 1;
+    int m_columns = 0;
+    std::vector<uint32_t> m_offsets;       // début de la liste de chaque tuile dans m_objects, et fin de la dernière
+    std::vector<const Object*> m_objects;  // listes des tuiles mises bout à bout
+    std::vector<uint32_t> m_ids;           // indice dans Scene::get_objects() de chaque entrée de m_objects
+};
+
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef __TILES_HPP__
+#define __TILES_HPP__
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+// Rectangle de pixels [x0, x1) x [y0, y1) rendu d'un seul tenant par un thread
+struct Tile {
+    int x0, y0;
+    int x1, y1;
+};
+
+// Ordre dans lequel les tuiles sont distribuées aux threads
+enum class TileOrder {
+    Scanline, // ligne par ligne
+    Morton,   // courbe en Z : des tuiles consécutives restent voisines à l'écran (cohérence de cache)
+    Spiral    // du centre de l'image vers les bords, où les objets sont en général moins nombreux
+};
+
+// Découpe l'image en tuiles et les distribue dynamiquement : chaque thread réclame la tuile suivante
+// avec un compteur atomique dès qu'il a fini la précédente. Les tuiles coûteuses (verre, miroirs)
+// ne bloquent donc pas les autres threads en fin d'image comme avec un découpage statique par lignes.
+class TileScheduler {
+public:
+    TileScheduler(int width, int height, int tile_size, TileOrder order) : m_next(0) {
+        tile_size = std::max(1, tile_size);
+        const int columns = (width + tile_size - 1) / tile_size;
+        const int rows = (height + tile_size - 1) / tile_size;
+
+        std::vector<int> grid_order;
+        if (order == TileOrder::Spiral) {
+            grid_order = spiral_order(columns, rows);
+        } else {
+            grid_order.resize(columns*rows);
+            for (int i = 0; i < columns*rows; i++) grid_order[i] = i;
+            if (order == TileOrder::Morton) {
+                std::stable_sort(grid_order.begin(), grid_order.end(), [columns](int a, int b) {
+                    return morton_code(a % columns, a / columns) < morton_code(b % columns, b / columns);
+                });
+            }
+        }
+
+        m_tiles.reserve(grid_order.size());
+        for (int cell : grid_order) {
+            int x0 = (cell % columns)*tile_size;
+            int y0 = (cell / columns)*tile_size;
+            m_tiles.push_back({x0, y0, std::min(x0 + tile_size, width), std::min(y0 + tile_size, height)});
+        }
+    }
+
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    size_t size() const { return m_tiles.size(); }
+    const Tile& get(size_t i) const { return m_tiles[i]; }
+
+    // Attribue au thread appelant l'indice de la prochaine tuile. Faux quand toutes les tuiles ont été distribuées.
+    bool next(size_t& index) {
+        index = m_next.fetch_add(1, std::memory_order_relaxed);
+        return index < m_tiles.size();
+    }
+
+    // Remet la distribution au début, pour rendre une nouvelle image avec le même découpage
+    void reset() { m_next.store(0, std::memory_order_relaxed); }
+
+private:
+    // Entrelace les bits de x et y
+    static uint64_t morton_code(uint32_t x, uint32_t y) {
+        uint64_t code = 0;
+        for (int bit = 0; bit < 32; bit++) {
+            code |= (uint64_t)((x >> bit) & 1) << (2*bit);
+            code |= (uint64_t)((y >> bit) & 1) << (2*bit + 1);
+        }
+        return code;
+    }
+
+    // Parcourt la grille en spirale carrée depuis la case centrale. Les cases hors de la grille
+    // sont sautées jusqu'à ce que toutes aient été visitées.
+    static std::vector<int> spiral_order(int columns, int rows) {
+        std::vector<int> cells;
+        cells.reserve(columns*rows);
+        int x = (columns - 1) / 2, y = (rows - 1) / 2;
+        const int dx[4] = {1, 0, -1, 0};
+        const int dy[4] = {0, 1, 0, -1};
+        int direction = 0;
+        for (int step = 1; (int)cells.size() < columns*rows; step++) {
+            // Chaque longueur de côté est parcourue deux fois : droite puis bas, gauche puis haut, ...
+            for (int side = 0; side < 2; side++) {
+                for (int k = 0; k < step; k++) {
+                    if (x >= 0 && x < columns && y >= 0 && y < rows) cells.push_back(y*columns + x);
+                    x += dx[direction];
+                    y += dy[direction];
+                }
+                direction = (direction + 1) % 4;
+            }
+        }
+        return cells;
+    }
+
+    std::vector<Tile> m_tiles;
+    std::atomic<size_t> m_next;
+};
+
+
+#endif
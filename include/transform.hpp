@@ -0,0 +1,118 @@
+#ifndef __TRANSFORM_HPP__
+#define __TRANSFORM_HPP__
+#include <cmath>
+#include "aabb.hpp"
+#include "vectors.hpp"
+
+// Transformation affine p -> L p + t, rangée en matrice 3 x 4 par lignes (m[i][3] = translation)
+class Transform {
+public:
+    // Identité
+    Transform() {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) m[i][j] = i == j ? 1.f : 0.f;
+        }
+    }
+
+    // Matrice 3 x 4 rangée par lignes, comme celle que rend get_matrix
+    explicit Transform(const float matrix[12]) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) m[i][j] = matrix[4*i + j];
+        }
+    }
+
+    // Mise à l'échelle, puis rotation de mêmes angles qu'un Parallelepiped, puis translation
+    static Transform compose(const Vec3f& translation, const Vec3f& scale, float angle_x, float angle_y, float angle_z) {
+        // Les colonnes de la rotation sont les axes locaux x, y et z exprimés dans le repère global
+        const Vec3f axes[3] = {
+            Vec3f(std::cos(angle_y) * std::cos(angle_z),
+                  std::sin(angle_x) * std::sin(angle_y) * std::cos(angle_z) - std::cos(angle_x) * std::sin(angle_z),
+                  std::cos(angle_x) * std::sin(angle_y) * std::cos(angle_z) + std::sin(angle_x) * std::sin(angle_z)),
+            Vec3f(std::cos(angle_y) * std::sin(angle_z),
+                  std::sin(angle_x) * std::sin(angle_y) * std::sin(angle_z) + std::cos(angle_x) * std::cos(angle_z),
+                  std::cos(angle_x) * std::sin(angle_y) * std::sin(angle_z) - std::sin(angle_x) * std::cos(angle_z)),
+            Vec3f(-std::sin(angle_y),
+                  std::sin(angle_x) * std::cos(angle_y),
+                  std::cos(angle_x) * std::cos(angle_y))
+        };
+        Transform transform;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) transform.m[i][j] = axes[j][i] * scale[j];
+            transform.m[i][3] = translation[i];
+        }
+        return transform;
+    }
+
+    // Transformation réciproque. La partie linéaire doit être inversible (pas d'échelle nulle).
+    Transform inverse() const {
+        Transform inv;
+        // Inverse de la partie linéaire par les cofacteurs
+        const float c00 = m[1][1]*m[2][2] - m[1][2]*m[2][1];
+        const float c01 = m[1][2]*m[2][0] - m[1][0]*m[2][2];
+        const float c02 = m[1][0]*m[2][1] - m[1][1]*m[2][0];
+        const float inv_det = 1.f / (m[0][0]*c00 + m[0][1]*c01 + m[0][2]*c02);
+        inv.m[0][0] = c00 * inv_det;
+        inv.m[1][0] = c01 * inv_det;
+        inv.m[2][0] = c02 * inv_det;
+        inv.m[0][1] = (m[0][2]*m[2][1] - m[0][1]*m[2][2]) * inv_det;
+        inv.m[1][1] = (m[0][0]*m[2][2] - m[0][2]*m[2][0]) * inv_det;
+        inv.m[2][1] = (m[0][1]*m[2][0] - m[0][0]*m[2][1]) * inv_det;
+        inv.m[0][2] = (m[0][1]*m[1][2] - m[0][2]*m[1][1]) * inv_det;
+        inv.m[1][2] = (m[0][2]*m[1][0] - m[0][0]*m[1][2]) * inv_det;
+        inv.m[2][2] = (m[0][0]*m[1][1] - m[0][1]*m[1][0]) * inv_det;
+        // Translation : -L^-1 t
+        for (int i = 0; i < 3; i++) inv.m[i][3] = -(inv.m[i][0]*m[0][3] + inv.m[i][1]*m[1][3] + inv.m[i][2]*m[2][3]);
+        return inv;
+    }
+
+    Vec3f apply_point(const Vec3f& p) const {
+        return Vec3f(m[0][0]*p.x + m[0][1]*p.y + m[0][2]*p.z + m[0][3],
+                     m[1][0]*p.x + m[1][1]*p.y + m[1][2]*p.z + m[1][3],
+                     m[2][0]*p.x + m[2][1]*p.y + m[2][2]*p.z + m[2][3]);
+    }
+
+    Vec3f apply_vector(const Vec3f& v) const {
+        return Vec3f(m[0][0]*v.x + m[0][1]*v.y + m[0][2]*v.z,
+                     m[1][0]*v.x + m[1][1]*v.y + m[1][2]*v.z,
+                     m[2][0]*v.x + m[2][1]*v.y + m[2][2]*v.z);
+    }
+
+    // Produit par la transposée de la partie linéaire. Appliqué à l'inverse d'une transformation,
+    // il transforme les normales de l'espace local vers l'espace global (résultat non normalisé).
+    Vec3f apply_transposed(const Vec3f& n) const {
+        return Vec3f(m[0][0]*n.x + m[1][0]*n.y + m[2][0]*n.z,
+                     m[0][1]*n.x + m[1][1]*n.y + m[2][1]*n.z,
+                     m[0][2]*n.x + m[1][2]*n.y + m[2][2]*n.z);
+    }
+
+    void get_matrix(float matrix[12]) const {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) matrix[4*i + j] = m[i][j];
+        }
+    }
+
+    Vec3f get_translation() const { return Vec3f(m[0][3], m[1][3], m[2][3]); }
+    void set_translation(const Vec3f& t) {
+        m[0][3] = t.x;
+        m[1][3] = t.y;
+        m[2][3] = t.z;
+    }
+
+    // Boîte englobante de l'image d'une boîte : centre transformé, demi-étendue par la valeur absolue
+    // de la partie linéaire
+    AABB apply_bounds(const AABB& box) const {
+        if (box.is_empty()) return box;
+        Vec3f center = apply_point(box.get_center());
+        Vec3f half = box.get_extent() * 0.5f;
+        Vec3f extent(std::abs(m[0][0])*half.x + std::abs(m[0][1])*half.y + std::abs(m[0][2])*half.z,
+                     std::abs(m[1][0])*half.x + std::abs(m[1][1])*half.y + std::abs(m[1][2])*half.z,
+                     std::abs(m[2][0])*half.x + std::abs(m[2][1])*half.y + std::abs(m[2][2])*half.z);
+        return AABB(center - extent, center + extent);
+    }
+
+private:
+    float m[3][4];
+};
+
+
+#endif
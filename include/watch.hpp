@@ -0,0 +1,22 @@
+#ifndef __WATCH_HPP__
+#define __WATCH_HPP__
+#include <string>
+#include <functional>
+#include "scene.hpp"
+#include "renderer.hpp"
+#include "image_writer.hpp"
+
+// Surveillance d'un fichier de scène (voir watch.cpp)
+
+// Remplit une scène vide : objets communs (le sol), puis ceux du fichier. Faux si le fichier n'a pas pu être lu.
+typedef std::function<bool(Scene&)> SceneLoader;
+
+// Rend la scène, puis relit le fichier à chaque modification et ne recalcule que les tuiles de l'image que
+// les objets ajoutés, supprimés ou modifiés peuvent changer ; le reste de l'image est gardé. Chaque mise à
+// jour est écrite dans options.output. Une modification qui ne peut pas être bornée à l'écran (lumières,
+// matériaux, plans, objet derrière la caméra...) fait recalculer toute l'image. Le rendu se fait en une
+// passe, sans anticrénelage. Ne rend la main (faux) que si le premier chargement échoue.
+bool watch_scene(const std::string& filename, const SceneLoader& load, const RenderOptions& options, ImageWriter& writer);
+
+
+#endif
@@ -0,0 +1,292 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "compiled_scene.hpp"
+#include "simd.hpp"
+#include "stats.hpp"
+#include "sphere.hpp"
+#include "plane.hpp"
+#include "parallelepiped.hpp"
+
+// Les primitives sont traitées par blocs : le noyau calcule la distance d'intersection de chaque primitive
+// du bloc (infinie si elle est ratée), puis on cherche la plus petite.
+// Les calculs sont écrits dans le même ordre que les versions scalaires des objets pour donner les mêmes distances.
+static const size_t BLOCK_SIZE = 64;
+
+static const float NO_HIT = std::numeric_limits<float>::infinity();
+
+
+OORT_MULTIVERSION
+static void sphere_distances(const float* cx, const float* cy, const float* cz, const float* radius, size_t n,
+                             const float ray[6], float t_min, float t_max, float* t_out) {
+    const float ox = ray[0], oy = ray[1], oz = ray[2], dx = ray[3], dy = ray[4], dz = ray[5];
+    #pragma omp simd
+    for (size_t k = 0; k < n; k++) {
+        float Lx = cx[k] - ox, Ly = cy[k] - oy, Lz = cz[k] - oz;
+        float tca = Lz*dz + Ly*dy + Lx*dx;
+        float d2 = Lz*Lz + Ly*Ly + Lx*Lx - tca*tca;
+        float r2 = radius[k]*radius[k];
+        float thc = sqrtf(lane_max(0.f, r2 - d2));
+        float t0 = tca - thc;
+        float t1 = tca + thc;
+        t0 = t0 < t_min ? t1 : t0;
+        bool hit = !(d2 > r2) & (t0 >= t_min) & (t0 < t_max);
+        t_out[k] = hit ? t0 : NO_HIT;
+    }
+}
+
+OORT_MULTIVERSION
+static void plane_distances(const float* nx, const float* ny, const float* nz, const float* distance, size_t n,
+                            const float ray[6], float t_min, float t_max, float* t_out) {
+    const float ox = ray[0], oy = ray[1], oz = ray[2], dx = ray[3], dy = ray[4], dz = ray[5];
+    #pragma omp simd
+    for (size_t k = 0; k < n; k++) {
+        float denom = nz[k]*dz + ny[k]*dy + nx[k]*dx;
+        float px = nx[k]*distance[k], py = ny[k]*distance[k], pz = nz[k]*distance[k];
+        float t0 = ((pz - oz)*nz[k] + (py - oy)*ny[k] + (px - ox)*nx[k]) / denom;
+        bool hit = (std::abs(denom) > 1e-6) & (t0 >= t_min) & (t0 < t_max);
+        t_out[k] = hit ? t0 : NO_HIT;
+    }
+}
+
+OORT_MULTIVERSION
+static void parallelepiped_distances(const float* px, const float* py, const float* pz, const float* const axis[9],
+                                     const float* hx, const float* hy, const float* hz, size_t n,
+                                     const float ray[6], float t_min, float t_max, float* t_out) {
+    const float ox = ray[0], oy = ray[1], oz = ray[2], dx = ray[3], dy = ray[4], dz = ray[5];
+    const float *bxx = axis[0], *bxy = axis[1], *bxz = axis[2];
+    const float *byx = axis[3], *byy = axis[4], *byz = axis[5];
+    const float *bzx = axis[6], *bzy = axis[7], *bzz = axis[8];
+    #pragma omp simd
+    for (size_t k = 0; k < n; k++) {
+        // Passage dans le repère local du parallélépipède
+        float vx = ox - px[k], vy = oy - py[k], vz = oz - pz[k];
+        float lox = vz*bxz[k] + vy*bxy[k] + vx*bxx[k];
+        float loy = vz*byz[k] + vy*byy[k] + vx*byx[k];
+        float loz = vz*bzz[k] + vy*bzy[k] + vx*bzx[k];
+        float ldx = dz*bxz[k] + dy*bxy[k] + dx*bxx[k];
+        float ldy = dz*byz[k] + dy*byy[k] + dx*byx[k];
+        float ldz = dz*bzz[k] + dy*bzy[k] + dx*bzx[k];
+
+        // Méthode des slabs, sans branchement
+        float a = (-lox - hx[k]) / ldx, b = (-lox + hx[k]) / ldx;
+        float tmin = a > b ? b : a, tmax = a > b ? a : b;
+        a = (-loy - hy[k]) / ldy; b = (-loy + hy[k]) / ldy;
+        float tymin = a > b ? b : a, tymax = a > b ? a : b;
+        bool hit = !((tmin > tymax) | (tymin > tmax));
+        tmin = tymin > tmin ? tymin : tmin;
+        tmax = tymax < tmax ? tymax : tmax;
+        a = (-loz - hz[k]) / ldz; b = (-loz + hz[k]) / ldz;
+        float tzmin = a > b ? b : a, tzmax = a > b ? a : b;
+        hit = hit & !((tmin > tzmax) | (tzmin > tmax));
+        tmin = tzmin > tmin ? tzmin : tmin;
+        tmax = tzmax < tmax ? tzmax : tmax;
+
+        float t0 = tmin < t_min ? tmax : tmin;
+        hit = hit & (t0 >= t_min) & (t0 < t_max);
+        t_out[k] = hit ? t0 : NO_HIT;
+    }
+}
+
+OORT_MULTIVERSION
+static float block_min(const float* t, size_t n) {
+    float closest = NO_HIT;
+    #pragma omp simd reduction(min:closest)
+    for (size_t k = 0; k < n; k++) closest = std::min(closest, t[k]);
+    return closest;
+}
+
+// Parcourt un tableau de primitives par blocs. distances(begin, count, t_max, t_out) remplit les distances
+// des primitives [begin, begin+count). En cas de succès t_max et object sont mis à jour.
+template <typename Distances>
+static bool closest_in_arrays(size_t n, const std::vector<uint32_t>& ids, float& t_max, uint32_t& object, Distances&& distances) {
+    bool found = false;
+    float t[BLOCK_SIZE];
+    for (size_t begin = 0; begin < n; begin += BLOCK_SIZE) {
+        size_t count = std::min(BLOCK_SIZE, n - begin);
+        distances(begin, count, t_max, t);
+        float closest = block_min(t, count);
+        if (closest < t_max) {
+            // À distance égale on garde la première primitive, comme le parcours linéaire des objets
+            size_t k = 0;
+            while (t[k] != closest) k++;
+            t_max = closest;
+            object = ids[begin + k];
+            found = true;
+        }
+    }
+    return found;
+}
+
+template <typename Distances>
+static bool any_in_arrays(size_t n, float t_max, Distances&& distances) {
+    float t[BLOCK_SIZE];
+    for (size_t begin = 0; begin < n; begin += BLOCK_SIZE) {
+        size_t count = std::min(BLOCK_SIZE, n - begin);
+        distances(begin, count, t_max, t);
+        if (block_min(t, count) < t_max) return true;
+    }
+    return false;
+}
+
+
+void CompiledScene::compile(const std::vector<Object*>& objects) {
+    m_spheres = SphereArrays();
+    m_parallelepipeds = ParallelepipedArrays();
+    m_planes = PlaneArrays();
+    m_others.clear();
+    m_other_ids.clear();
+    m_slots.assign(objects.size(), 0);
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        uint32_t id = static_cast<uint32_t>(i);
+        if (const Sphere* sphere = dynamic_cast<const Sphere*>(objects[i])) {
+            m_slots[i] = static_cast<uint32_t>(m_spheres.id.size());
+            Vec3f center = sphere->get_position();
+            m_spheres.cx.push_back(center.x);
+            m_spheres.cy.push_back(center.y);
+            m_spheres.cz.push_back(center.z);
+            m_spheres.radius.push_back(sphere->get_radius());
+            m_spheres.id.push_back(id);
+        } else if (const Parallelepiped* box = dynamic_cast<const Parallelepiped*>(objects[i])) {
+            m_slots[i] = static_cast<uint32_t>(m_parallelepipeds.id.size());
+            Vec3f position = box->get_position(), half_size = box->get_half_size();
+            Vec3f axes[3] = {box->get_direction_x(), box->get_direction_y(), box->get_direction_z()};
+            m_parallelepipeds.px.push_back(position.x);
+            m_parallelepipeds.py.push_back(position.y);
+            m_parallelepipeds.pz.push_back(position.z);
+            for (int a = 0; a < 3; a++) {
+                m_parallelepipeds.axis[3*a].push_back(axes[a].x);
+                m_parallelepipeds.axis[3*a + 1].push_back(axes[a].y);
+                m_parallelepipeds.axis[3*a + 2].push_back(axes[a].z);
+            }
+            m_parallelepipeds.hx.push_back(half_size.x);
+            m_parallelepipeds.hy.push_back(half_size.y);
+            m_parallelepipeds.hz.push_back(half_size.z);
+            m_parallelepipeds.id.push_back(id);
+        } else if (const Plane* plane = dynamic_cast<const Plane*>(objects[i])) {
+            // Un CheckerboardPlane a la géométrie d'un Plane ; son matériau est résolu après le parcours
+            m_slots[i] = static_cast<uint32_t>(m_planes.id.size());
+            Vec3f normal = plane->get_plane_normal();
+            m_planes.nx.push_back(normal.x);
+            m_planes.ny.push_back(normal.y);
+            m_planes.nz.push_back(normal.z);
+            m_planes.distance.push_back(plane->get_distance());
+            m_planes.id.push_back(id);
+        } else {
+            m_others.push_back(objects[i]);
+            m_other_ids.push_back(id);
+        }
+    }
+}
+
+void CompiledScene::update(const std::vector<Object*>& objects, const std::vector<uint32_t>& moved) {
+    for (uint32_t i : moved) {
+        const uint32_t slot = m_slots[i];
+        if (const Sphere* sphere = dynamic_cast<const Sphere*>(objects[i])) {
+            Vec3f center = sphere->get_position();
+            m_spheres.cx[slot] = center.x;
+            m_spheres.cy[slot] = center.y;
+            m_spheres.cz[slot] = center.z;
+        } else if (const Parallelepiped* box = dynamic_cast<const Parallelepiped*>(objects[i])) {
+            Vec3f position = box->get_position();
+            m_parallelepipeds.px[slot] = position.x;
+            m_parallelepipeds.py[slot] = position.y;
+            m_parallelepipeds.pz[slot] = position.z;
+        } else if (const Plane* plane = dynamic_cast<const Plane*>(objects[i])) {
+            m_planes.distance[slot] = plane->get_distance();
+        }
+        // Les autres objets sont testés par appel virtuel : rien à recopier
+    }
+}
+
+bool CompiledScene::intersect(const Vec3f& orig, const Vec3f& dir, float t_min, float& t_max, uint32_t& object) const {
+    const float ray[6] = {orig.x, orig.y, orig.z, dir.x, dir.y, dir.z};
+    const SphereArrays& s = m_spheres;
+    const ParallelepipedArrays& b = m_parallelepipeds;
+    const PlaneArrays& p = m_planes;
+    bool found = false;
+
+    found |= closest_in_arrays(s.id.size(), s.id, t_max, object, [&](size_t i, size_t n, float t1, float* t) {
+        OORT_STAT_ADD(SphereTests, n);
+        sphere_distances(&s.cx[i], &s.cy[i], &s.cz[i], &s.radius[i], n, ray, t_min, t1, t);
+    });
+    found |= closest_in_arrays(b.id.size(), b.id, t_max, object, [&](size_t i, size_t n, float t1, float* t) {
+        OORT_STAT_ADD(ParallelepipedTests, n);
+        const float* axis[9];
+        for (int a = 0; a < 9; a++) axis[a] = &b.axis[a][i];
+        parallelepiped_distances(&b.px[i], &b.py[i], &b.pz[i], axis, &b.hx[i], &b.hy[i], &b.hz[i], n, ray, t_min, t1, t);
+    });
+    found |= closest_in_arrays(p.id.size(), p.id, t_max, object, [&](size_t i, size_t n, float t1, float* t) {
+        OORT_STAT_ADD(PlaneTests, n);
+        plane_distances(&p.nx[i], &p.ny[i], &p.nz[i], &p.distance[i], n, ray, t_min, t1, t);
+    });
+
+    for (size_t i = 0; i < m_others.size(); i++) {
+        float dist;
+        OORT_STAT(OtherTests);
+        if (m_others[i]->ray_intersect(orig, dir, dist, t_min, t_max)) {
+            t_max = dist;
+            object = m_other_ids[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool CompiledScene::occluded(const Vec3f& orig, const Vec3f& dir, float t_min, float t_max) const {
+    const float ray[6] = {orig.x, orig.y, orig.z, dir.x, dir.y, dir.z};
+    const SphereArrays& s = m_spheres;
+    const ParallelepipedArrays& b = m_parallelepipeds;
+    const PlaneArrays& p = m_planes;
+
+    if (any_in_arrays(s.id.size(), t_max, [&](size_t i, size_t n, float t1, float* t) {
+            OORT_STAT_ADD(SphereTests, n);
+            sphere_distances(&s.cx[i], &s.cy[i], &s.cz[i], &s.radius[i], n, ray, t_min, t1, t);
+        })) return true;
+    if (any_in_arrays(b.id.size(), t_max, [&](size_t i, size_t n, float t1, float* t) {
+            OORT_STAT_ADD(ParallelepipedTests, n);
+            const float* axis[9];
+            for (int a = 0; a < 9; a++) axis[a] = &b.axis[a][i];
+            parallelepiped_distances(&b.px[i], &b.py[i], &b.pz[i], axis, &b.hx[i], &b.hy[i], &b.hz[i], n, ray, t_min, t1, t);
+        })) return true;
+    if (any_in_arrays(p.id.size(), t_max, [&](size_t i, size_t n, float t1, float* t) {
+            OORT_STAT_ADD(PlaneTests, n);
+            plane_distances(&p.nx[i], &p.ny[i], &p.nz[i], &p.distance[i], n, ray, t_min, t1, t);
+        })) return true;
+
+    float dist;
+    for (const Object* object : m_others) {
+        OORT_STAT(OtherTests);
+        if (object->ray_intersect(orig, dir, dist, t_min, t_max)) return true;
+    }
+    return false;
+}
+
+void CompiledScene::intersect_packet(RayPacket& packet) const {
+    // Les tests sont comptés par rayon du paquet, comme pour les rayons seuls
+    OORT_STAT_ADD(SphereTests, m_spheres.id.size()*PACKET_SIZE);
+    OORT_STAT_ADD(ParallelepipedTests, m_parallelepipeds.id.size()*PACKET_SIZE);
+    OORT_STAT_ADD(PlaneTests, m_planes.id.size()*PACKET_SIZE);
+    OORT_STAT_ADD(OtherTests, m_others.size()*PACKET_SIZE);
+    const SphereArrays& s = m_spheres;
+    for (size_t i = 0; i < s.id.size(); i++) {
+        packet_intersect_sphere(packet, s.cx[i], s.cy[i], s.cz[i], s.radius[i], static_cast<int32_t>(s.id[i]));
+    }
+    const ParallelepipedArrays& b = m_parallelepipeds;
+    for (size_t i = 0; i < b.id.size(); i++) {
+        const float position[3] = {b.px[i], b.py[i], b.pz[i]};
+        const float half_size[3] = {b.hx[i], b.hy[i], b.hz[i]};
+        float basis[9];
+        for (int a = 0; a < 9; a++) basis[a] = b.axis[a][i];
+        packet_intersect_parallelepiped(packet, position, basis, half_size, static_cast<int32_t>(b.id[i]));
+    }
+    const PlaneArrays& p = m_planes;
+    for (size_t i = 0; i < p.id.size(); i++) {
+        packet_intersect_plane(packet, p.nx[i], p.ny[i], p.nz[i], p.distance[i], static_cast<int32_t>(p.id[i]));
+    }
+    for (size_t i = 0; i < m_others.size(); i++) {
+        m_others[i]->ray_intersect_packet(packet, static_cast<int32_t>(m_other_ids[i]));
+    }
+}
@@ -0,0 +1,278 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "distributed.hpp"
+
+
+// Tuiles envoyées d'avance à chaque processus : il enchaîne sur la suivante sans attendre le coordinateur
+static const size_t MAX_IN_FLIGHT = 2;
+// Une tuile qui a fait échouer autant de processus n'est plus redistribuée : l'image est abandonnée
+static const int MAX_TILE_ATTEMPTS = 3;
+
+// Écriture et lecture complètes sur une socket. MSG_NOSIGNAL : écrire vers un processus arrêté
+// renvoie une erreur au lieu de tuer le coordinateur par SIGPIPE.
+static bool send_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool receive_all(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool send_message(int fd, MessageType type, const void* data, size_t size) {
+    MessageHeader header = {static_cast<uint32_t>(type), static_cast<uint32_t>(size)};
+    return send_all(fd, &header, sizeof(header)) && (size == 0 || send_all(fd, data, size));
+}
+
+
+// ---------------------------------------------------------------------------------------------------------
+// Processus de rendu
+
+// Boucle d'un processus de rendu : rend les tuiles demandées jusqu'au message Quit ou à la fermeture
+// de la socket
+static void worker_loop(int fd, const Scene &scene, const RenderOptions &options) {
+    uint32_t version = TILE_PROTOCOL_VERSION;
+    if (!send_message(fd, MessageType::Hello, &version, sizeof(version))) return;
+
+    // Lignes de la tuile en cours, réutilisées d'une tuile à l'autre
+    std::vector<Vec3f> framebuffer;
+    std::vector<char> message;
+    MessageHeader header;
+    while (receive_all(fd, &header, sizeof(header))) {
+        if (header.type != static_cast<uint32_t>(MessageType::Tile) || header.size != sizeof(TileRequest)) return;
+        TileRequest request;
+        if (!receive_all(fd, &request, sizeof(request))) return;
+
+        Tile tile = {request.x0, request.y0, request.x1, request.y1};
+        render_region(scene, options, tile, framebuffer);
+
+        // Les pixels de la tuile sont envoyés ligne par ligne, à la suite de TileResult
+        TileResult result = {request.tile, static_cast<uint32_t>((tile.x1 - tile.x0)*(tile.y1 - tile.y0))};
+        message.resize(sizeof(result) + result.pixel_count*sizeof(Vec3f));
+        std::memcpy(message.data(), &result, sizeof(result));
+        char* pixels = message.data() + sizeof(result);
+        for (int y = tile.y0; y < tile.y1; y++) {
+            size_t row = (tile.x1 - tile.x0)*sizeof(Vec3f);
+            std::memcpy(pixels, &framebuffer[static_cast<size_t>(y - tile.y0)*options.width + tile.x0], row);
+            pixels += row;
+        }
+        if (!send_message(fd, MessageType::Result, message.data(), message.size())) return;
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------------------
+// Coordinateur
+
+struct WorkerProcess {
+    pid_t pid;
+    int fd;
+    bool ready;                    // message Hello reçu
+    std::deque<uint32_t> in_flight; // tuiles envoyées, pas encore rendues
+};
+
+// Crée un processus de rendu. Il hérite de la scène du coordinateur par fork, sans la relire.
+static bool spawn_worker(const Scene &scene, const RenderOptions &options,
+                         const std::vector<WorkerProcess> &others, WorkerProcess &worker) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        std::cerr << "Erreur : socketpair : " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Les tampons de sortie seraient sinon écrits une seconde fois par le processus fils
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Erreur : fork : " << std::strerror(errno) << std::endl;
+        close(sockets[0]);
+        close(sockets[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(sockets[0]);
+        for (const WorkerProcess &other : others) {
+            if (other.fd >= 0) close(other.fd);
+        }
+        worker_loop(sockets[1], scene, options);
+        // _exit : le fils ne doit ni détruire les objets du coordinateur ni attendre son thread d'écriture
+        _exit(0);
+    }
+    close(sockets[1]);
+    worker = {pid, sockets[0], false, {}};
+    return true;
+}
+
+// Arrête un processus qui a échoué et récupère son état pour l'afficher
+static void reap_worker(WorkerProcess &worker, const char* reason) {
+    close(worker.fd);
+    worker.fd = -1;
+    kill(worker.pid, SIGKILL); // sans effet s'il est déjà arrêté
+    int status = 0;
+    waitpid(worker.pid, &status, 0);
+    std::cerr << "Processus de rendu " << worker.pid << " arrêté (" << reason;
+    if (WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL) std::cerr << ", signal " << WTERMSIG(status);
+    std::cerr << "), " << worker.in_flight.size() << " tuile(s) redistribuée(s)" << std::endl;
+}
+
+// Lit un message du processus. Faux si le processus s'est arrêté ou a envoyé un message invalide.
+static bool receive_result(WorkerProcess &worker, const TileScheduler &tiles, int width,
+                           std::vector<Vec3f> &framebuffer, std::vector<char> &done, size_t &done_count) {
+    MessageHeader header;
+    if (!receive_all(worker.fd, &header, sizeof(header))) return false;
+    if (header.type == static_cast<uint32_t>(MessageType::Hello)) {
+        uint32_t version;
+        if (header.size != sizeof(version) || !receive_all(worker.fd, &version, sizeof(version))) return false;
+        worker.ready = version == TILE_PROTOCOL_VERSION;
+        return worker.ready;
+    }
+    TileResult result;
+    if (header.type != static_cast<uint32_t>(MessageType::Result) || header.size < sizeof(result) ||
+        !receive_all(worker.fd, &result, sizeof(result))) return false;
+    // Seule une tuile confiée à ce processus est acceptée, avec exactement ses pixels
+    auto it = std::find(worker.in_flight.begin(), worker.in_flight.end(), result.tile);
+    if (it == worker.in_flight.end()) return false;
+    const Tile &tile = tiles.get(result.tile);
+    const size_t row = tile.x1 - tile.x0;
+    if (result.pixel_count != row*(tile.y1 - tile.y0) || header.size != sizeof(result) + result.pixel_count*sizeof(Vec3f)) {
+        return false;
+    }
+    for (int y = tile.y0; y < tile.y1; y++) {
+        if (!receive_all(worker.fd, &framebuffer[static_cast<size_t>(y)*width + tile.x0], row*sizeof(Vec3f))) return false;
+    }
+    worker.in_flight.erase(it);
+    if (!done[result.tile]) {
+        done[result.tile] = 1;
+        done_count++;
+    }
+    return true;
+}
+
+bool render_distributed(const Scene &scene, const RenderOptions &options, ImageWriter &writer) {
+    const int width = options.width, height = options.height;
+    const double start = omp_get_wtime();
+    TileScheduler tiles(width, height, options.tile_size, options.tile_order);
+    std::vector<Vec3f> framebuffer(static_cast<size_t>(height)*width);
+    std::vector<char> done(tiles.size(), 0);
+    std::vector<int> attempts(tiles.size(), 0);
+    size_t done_count = 0;
+
+    std::deque<uint32_t> pending;
+    for (size_t i = 0; i < tiles.size(); i++) pending.push_back(static_cast<uint32_t>(i));
+
+    // Un processus qui s'arrête est remplacé, dans la limite de respawns_left remplacements
+    std::vector<WorkerProcess> workers;
+    int respawns_left = 2*options.workers + 2;
+    for (int k = 0; k < options.workers; k++) {
+        WorkerProcess worker;
+        if (!spawn_worker(scene, options, workers, worker)) break;
+        workers.push_back(worker);
+    }
+
+    bool failed = workers.empty();
+    size_t crashes = 0;
+    while (!failed && done_count < tiles.size()) {
+        // Chaque processus prêt reçoit jusqu'à MAX_IN_FLIGHT tuiles d'avance
+        for (WorkerProcess &worker : workers) {
+            while (worker.fd >= 0 && worker.ready && worker.in_flight.size() < MAX_IN_FLIGHT && !pending.empty()) {
+                uint32_t index = pending.front();
+                pending.pop_front();
+                if (done[index]) continue;
+                const Tile &tile = tiles.get(index);
+                TileRequest request = {index, tile.x0, tile.y0, tile.x1, tile.y1};
+                worker.in_flight.push_back(index);
+                if (!send_message(worker.fd, MessageType::Tile, &request, sizeof(request))) break;
+            }
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<size_t> owners;
+        for (size_t k = 0; k < workers.size(); k++) {
+            if (workers[k].fd < 0) continue;
+            fds.push_back({workers[k].fd, POLLIN, 0});
+            owners.push_back(k);
+        }
+        if (fds.empty()) {
+            std::cerr << "Erreur : plus aucun processus de rendu" << std::endl;
+            failed = true;
+            break;
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Erreur : poll : " << std::strerror(errno) << std::endl;
+            failed = true;
+            break;
+        }
+
+        for (size_t f = 0; f < fds.size() && !failed; f++) {
+            if (fds[f].revents == 0) continue;
+            WorkerProcess &worker = workers[owners[f]];
+            if (receive_result(worker, tiles, width, framebuffer, done, done_count)) continue;
+
+            // Processus arrêté ou incohérent : ses tuiles repartent en tête de file
+            crashes++;
+            reap_worker(worker, worker.ready ? "pendant le rendu" : "au démarrage");
+            for (auto it = worker.in_flight.rbegin(); it != worker.in_flight.rend(); ++it) {
+                if (done[*it]) continue;
+                if (++attempts[*it] >= MAX_TILE_ATTEMPTS) {
+                    std::cerr << "Erreur : la tuile " << *it << " a fait échouer " << MAX_TILE_ATTEMPTS
+                              << " processus, rendu abandonné" << std::endl;
+                    failed = true;
+                }
+                pending.push_front(*it);
+            }
+            worker.in_flight.clear();
+            if (!failed && respawns_left > 0) {
+                respawns_left--;
+                WorkerProcess replacement;
+                if (spawn_worker(scene, options, workers, replacement)) worker = replacement;
+            }
+        }
+    }
+
+    // Fin du travail : les processus restants sont arrêtés proprement
+    for (WorkerProcess &worker : workers) {
+        if (worker.fd < 0) continue;
+        send_message(worker.fd, MessageType::Quit, nullptr, 0);
+        close(worker.fd);
+        waitpid(worker.pid, nullptr, 0);
+    }
+
+    if (options.thread_report) {
+        std::cout << "Rendu : " << tiles.size() << " tuiles en " << omp_get_wtime() - start << " s sur "
+                  << options.workers << " processus, " << crashes << " arrêt(s) de processus" << std::endl;
+    }
+    if (failed) return false;
+    writer.submit(options.output, choose_image_format(options.output, options.format), width, height, std::move(framebuffer));
+    return true;
+}
@@ -0,0 +1,161 @@
+#include <random>
+#include <cmath>
+#include <vector>
+
+#include "generators.hpp"
+#include "sphere.hpp"
+#include "parallelepiped.hpp"
+#include "plane.hpp"
+#include "instance.hpp"
+#include "mesh.hpp"
+#include "light.hpp"
+
+// Profondeurs entre lesquelles les objets sont placés
+static const float NEAR_Z = -10.f;
+static const float FAR_Z = -60.f;
+static const float FLOOR_Y = -4.f;
+
+static MaterialId material_id(const Scene& scene, const char* name) {
+    MaterialId id = 0;
+    scene.get_materials().find(name, id);
+    return id;
+}
+
+// Point tiré au hasard dans le champ de la caméra (angle vertical de 1 radian, image 4/3), au-dessus du sol
+static Vec3f random_point_in_view(std::mt19937& random, float margin) {
+    std::uniform_real_distribution<float> depth(FAR_Z, NEAR_Z);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    const float z = depth(random);
+    const float half_height = -z*std::tan(0.5f);
+    const float half_width = half_height*4.f/3.f;
+    const float x = unit(random)*half_width;
+    const float y = FLOOR_Y + margin + (unit(random)*0.5f + 0.5f)*(half_height - FLOOR_Y - margin);
+    return Vec3f(x, y, z);
+}
+
+void add_checkerboard_floor(Scene& scene) {
+    scene.add_object(new CheckerboardPlane(Vec3f(0, 1, 0), FLOOR_Y, material_id(scene, "grey_metal"),
+                                           material_id(scene, "blue_metal"), 2));
+}
+
+// Sphères de tailles et de matériaux aléatoires, sans lumière
+static void add_random_spheres(Scene& scene, size_t count, std::mt19937& random) {
+    std::uniform_real_distribution<float> radius(0.2f, 0.8f);
+    const MaterialId materials[3] = {material_id(scene, "ivory"), material_id(scene, "red_rubber"),
+                                     material_id(scene, "grey_metal")};
+    std::uniform_int_distribution<int> material(0, 2);
+    for (size_t i = 0; i < count; i++) {
+        float r = radius(random);
+        scene.add_object(new Sphere(random_point_in_view(random, r), r, materials[material(random)]));
+    }
+}
+
+void generate_random_spheres(Scene& scene, size_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    add_random_spheres(scene, count, random);
+    scene.add_light(Light(Vec3f(-20, 20, 20), 1.5));
+}
+
+void generate_parallelepiped_grid(Scene& scene, size_t nx, size_t ny, size_t nz, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> side(0.8f, 1.6f);
+    std::uniform_real_distribution<float> angle(0.f, float(M_PI));
+    const MaterialId materials[2] = {material_id(scene, "ivory"), material_id(scene, "red_rubber")};
+    const float spacing = 3.f;
+    for (size_t k = 0; k < nz; k++) {
+        for (size_t j = 0; j < ny; j++) {
+            for (size_t i = 0; i < nx; i++) {
+                Vec3f center((i - (nx - 1)*0.5f)*spacing, FLOOR_Y + 2.f + j*spacing, NEAR_Z - 5.f - k*spacing);
+                Vec3f size(side(random), side(random), side(random));
+                scene.add_object(new Parallelepiped(center, size, materials[(i + j + k) % 2],
+                                                    angle(random), angle(random), angle(random)));
+            }
+        }
+    }
+    scene.add_light(Light(Vec3f(-20, 20, 20), 1.5));
+}
+
+void generate_glass_scene(Scene& scene, size_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> radius(0.5f, 1.5f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const MaterialId glass = material_id(scene, "glass");
+    const MaterialId mirror = material_id(scene, "mirror");
+    for (size_t i = 0; i < count; i++) {
+        float r = radius(random);
+        scene.add_object(new Sphere(random_point_in_view(random, r), r, unit(random) < 0.7f ? glass : mirror));
+    }
+    scene.add_light(Light(Vec3f(-20, 20, 20), 1.5));
+}
+
+void generate_many_lights(Scene& scene, size_t object_count, size_t light_count, uint32_t seed) {
+    std::mt19937 random(seed);
+    add_random_spheres(scene, object_count, random);
+    // Lumières au-dessus de la scène, réparties sur une large zone
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    for (size_t i = 0; i < light_count; i++) {
+        Vec3f position(unit(random)*40.f, 5.f + (unit(random)*0.5f + 0.5f)*30.f, unit(random)*40.f - 20.f);
+        scene.add_light(Light(position, 2.f/light_count));
+    }
+}
+
+void generate_light_rig(Scene& scene, size_t object_count, size_t light_count, float radius, uint32_t seed) {
+    std::mt19937 random(seed);
+    add_random_spheres(scene, object_count, random);
+    // Lumières réparties dans le champ de la caméra, au milieu des objets, chacune n'éclairant que son voisinage
+    std::uniform_real_distribution<float> intensity(0.5f, 1.5f);
+    for (size_t i = 0; i < light_count; i++) {
+        scene.add_light(Light(random_point_in_view(random, 1.f), intensity(random), radius));
+    }
+}
+
+void generate_forest(Scene& scene, size_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    // Arbre d'un mètre de haut environ, le pied à l'origine du prototype
+    std::vector<Object*> tree;
+    tree.push_back(new Parallelepiped(Vec3f(0, 0.3f, 0), Vec3f(0.15f, 0.6f, 0.15f), material_id(scene, "red_rubber")));
+    tree.push_back(new Sphere(Vec3f(0, 0.75f, 0), 0.35f, material_id(scene, "grey_metal")));
+    tree.push_back(new Sphere(Vec3f(0.1f, 1.05f, 0.05f), 0.22f, material_id(scene, "ivory")));
+    const Object* prototype = scene.add_prototype(new Group(tree));
+
+    std::uniform_real_distribution<float> depth(FAR_Z, NEAR_Z);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::uniform_real_distribution<float> size(0.6f, 1.4f);
+    std::uniform_real_distribution<float> angle(0.f, 2.f*float(M_PI));
+    for (size_t i = 0; i < count; i++) {
+        const float z = depth(random);
+        const float x = unit(random)*(-z*std::tan(0.5f)*4.f/3.f);
+        const float s = size(random);
+        scene.add_object(new Instance(prototype, Transform::compose(Vec3f(x, FLOOR_Y, z), Vec3f(s, s, s), 0.f, angle(random), 0.f)));
+    }
+    scene.add_light(Light(Vec3f(-20, 20, 20), 1.5));
+}
+
+void generate_torus_mesh(Scene& scene, size_t segments, size_t sides) {
+    const float major = 3.f, minor = 1.2f;
+    std::vector<Vec3f> vertices, normals;
+    std::vector<uint32_t> triangles;
+    for (size_t i = 0; i < segments; i++) {
+        const float u = 2.f*float(M_PI)*i/segments;
+        for (size_t j = 0; j < sides; j++) {
+            const float v = 2.f*float(M_PI)*j/sides;
+            const Vec3f normal(std::cos(v)*std::cos(u), std::sin(v), std::cos(v)*std::sin(u));
+            vertices.push_back(Vec3f(major*std::cos(u), 0.f, major*std::sin(u)) + normal*minor);
+            normals.push_back(normal);
+        }
+    }
+    for (size_t i = 0; i < segments; i++) {
+        for (size_t j = 0; j < sides; j++) {
+            const uint32_t a = static_cast<uint32_t>(i*sides + j);
+            const uint32_t b = static_cast<uint32_t>(((i + 1) % segments)*sides + j);
+            const uint32_t c = static_cast<uint32_t>(((i + 1) % segments)*sides + (j + 1) % sides);
+            const uint32_t d = static_cast<uint32_t>(i*sides + (j + 1) % sides);
+            const uint32_t quad[6] = {a, d, c, a, c, b};
+            triangles.insert(triangles.end(), quad, quad + 6);
+        }
+    }
+    std::vector<uint32_t> normal_indices = triangles;
+    scene.add_object(new TriangleMesh(std::move(vertices), std::move(triangles), std::move(normals), std::move(normal_indices),
+                                      material_id(scene, "red_rubber"), Vec3f(0, FLOOR_Y + minor, NEAR_Z - 8.f)));
+    scene.add_light(Light(Vec3f(-20, 20, 20), 1.5));
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "image_output.hpp"
+#include "simd.hpp"
+#include "stats.hpp"
+
+static_assert(sizeof(Vec3f) == 3*sizeof(float), "l'image est lue comme un tableau de flottants");
+
+ImageFormat choose_image_format(const std::string& filename, const std::string& format) {
+    if (format == "pfm") return ImageFormat::PFM;
+    if (format == "ppm") return ImageFormat::PPM;
+    if (!format.empty()) std::cerr << "Format d'image inconnu : " << format << ", PPM utilisé" << std::endl;
+    const std::string extension = ".pfm";
+    if (filename.size() >= extension.size() &&
+        filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0) {
+        return ImageFormat::PFM;
+    }
+    return ImageFormat::PPM;
+}
+
+// Même arrondi que (char)(255 * std::max(0.f, std::min(1.f, v))) : troncature vers zéro
+OORT_MULTIVERSION
+void quantize_rgb8(const float* values, size_t count, uint8_t* out) {
+    #pragma omp simd
+    for (size_t k = 0; k < count; k++) {
+        float v = lane_max(0.f, lane_min(1.f, values[k]));
+        out[k] = static_cast<uint8_t>(static_cast<int>(255 * v));
+    }
+}
+
+std::string image_header(ImageFormat format, int width, int height) {
+    // PFM : échelle négative pour des flottants petit-boutistes
+    if (format == ImageFormat::PFM) return "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+    return "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+}
+
+std::vector<char> encode_image(ImageFormat format, int width, int height, const std::vector<Vec3f>& framebuffer) {
+    const float* values = reinterpret_cast<const float*>(framebuffer.data());
+    const size_t row = 3*static_cast<size_t>(width);
+    const std::string header = image_header(format, width, height);
+    std::vector<char> image;
+    if (format == ImageFormat::PFM) {
+        // Les lignes sont rangées de bas en haut
+        image.resize(header.size() + row*height*sizeof(float));
+        char* pixels = image.data() + header.size();
+        for (int j = 0; j < height; j++) {
+            std::memcpy(pixels + (height - 1 - j)*row*sizeof(float), values + j*row, row*sizeof(float));
+        }
+    } else {
+        image.resize(header.size() + row*height);
+        quantize_rgb8(values, row*height, reinterpret_cast<uint8_t*>(image.data() + header.size()));
+    }
+    std::memcpy(image.data(), header.data(), header.size());
+    return image;
+}
+
+bool write_image(const std::string& filename, ImageFormat format, int width, int height,
+                 const std::vector<Vec3f>& framebuffer) {
+    OORT_PHASE_TIMER(Output);
+    std::vector<char> image = encode_image(format, width, height, framebuffer);
+    const bool to_stdout = filename == "-";
+    std::FILE* file = to_stdout ? stdout : std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Erreur : impossible d'écrire l'image " << filename << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    ok = (to_stdout ? std::fflush(file) : std::fclose(file)) == 0 && ok;
+    if (!ok) std::cerr << "Erreur : impossible d'écrire l'image " << filename << std::endl;
+    return ok;
+}
@@ -8,6 +8,8 @@
 #include <sstream>
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <map>
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
 #include <omp.h>
@@ -18,224 +20,425 @@
 #include "light.hpp"
 #include "parallelepiped.hpp"
 #include "plane.hpp"
+#include "scene.hpp"
+#include "packet.hpp"
+#include "tiles.hpp"
+#include "progressive.hpp"
+#include "scene_io.hpp"
+#include "number_parsing.hpp"
+#include "image_writer.hpp"
+#include "renderer.hpp"
+#include "watch.hpp"
+#include "stats.hpp"
 
 
 
 
-bool scene_intersect(const Vec3f &orig, const Vec3f &dir, const std::vector<Object*> &objects, Vec3f &hit, Vec3f &N, Material &material) {
-    float closest_dist = std::numeric_limits<float>::max();
-    for (const auto& object : objects) {
-        float dist_i;
-        if (object->ray_intersect(orig, dir, dist_i) && dist_i < closest_dist) {
-            closest_dist = dist_i;
-            hit = orig + dir*dist_i;
-            N = object->get_normal(hit);
-            material = object->get_material(hit);
-        }
+std::vector<std::string> split(const std::string& s, char delimiter) {
+    std::vector<std::string> tokens;
+    std::string token;
+    std::istringstream tokenStream(s);
+    while (getline(tokenStream, token, delimiter)) {
+        tokens.push_back(token);
     }
-    return closest_dist < 1000;
-}
-
-Vec3f reflect(const Vec3f &I, const Vec3f &N) {
-    return I - N*2.f*(I*N);
+    return tokens;
 }
 
-Vec3f refract(const Vec3f &I, const Vec3f &N, const float &refractive_index) { // implémentation de la loi de Snell
-    float cosi = - std::max(-1.f, std::min(1.f, I*N));
-    float etai = 1, etat = refractive_index;
-    Vec3f n = N;
-    if (cosi < 0) { // si le rayon est à l'intérieur de l'objet, on échange les indices et on inverse la normale pour obtenir le résultat correct
-        cosi = -cosi;
-        std::swap(etai, etat); n = -N;
+std::string trim(const std::string& str) {
+    size_t first = str.find_first_not_of(' ');
+    if (std::string::npos == first) {
+        return "";
     }
-    float eta = etai / etat;
-    float k = 1 - eta*eta*(1 - cosi*cosi);
-    return k < 0 ? Vec3f(0,0,0) : I*eta + n*(eta * cosi - sqrtf(k));
+    size_t last = str.find_last_not_of(' ');
+    return str.substr(first, (last - first + 1));
 }
 
+// Valeur numérique d'une option de la ligne de commande ; écrit l'erreur et rend faux si elle est invalide
+template <typename T>
+bool parse_option(const std::string& option, const std::string& text, T& value, T min = std::numeric_limits<T>::lowest(),
+                  T max = std::numeric_limits<T>::max()) {
+    if (parse_number(text, value, min, max)) return true;
+    std::cerr << "Erreur : valeur invalide pour " << option << " : " << text << std::endl;
+    return false;
+}
 
-Vec3f cast_ray(const Vec3f &orig, const Vec3f &dir, const std::vector<Object*> &objects, const std::vector<Light> &lights,
-char* reflection_model, size_t depth=0){
-    Vec3f point, N;
-    Material material;
-
-    if (depth>4 || !scene_intersect(orig, dir, objects, point, N, material)) {
-        return Vec3f(0.3, 0.3, 0.3); // fond gris
-    }
-
-    Vec3f reflect_dir = reflect(dir, N).normalize();
-    Vec3f reflect_orig = reflect_dir*N < 0 ? point - N*1e-3 : point + N*1e-3; // offset the original point to avoid occlusion by the object itself
-    Vec3f reflect_color = cast_ray(reflect_orig, reflect_dir, objects, lights, reflection_model, depth + 1);
+// Angle de vue en degrés, strictement entre 0 et 180, converti en radians. Faux si le texte est invalide.
+bool parse_fov(const std::string& text, double& fov) {
+    double degrees = 0.;
+    if (!parse_number(text, degrees) || !(degrees > 0. && degrees < 180.)) return false;
+    fov = degrees*M_PI/180.;
+    return true;
+}
 
-    Vec3f refract_dir = refract(dir, N, material.get_refractive_index()).normalize();
-    Vec3f refract_orig = refract_dir*N < 0 ? point - N*1e-3 : point + N*1e-3;
-    Vec3f refract_color = cast_ray(refract_orig, refract_dir, objects, lights, reflection_model, depth + 1);
+// Quand une image est envoyée sur la sortie standard, les messages de std::cout sont redirigés vers
+// la sortie d'erreur pour ne pas se mêler aux octets de l'image
+void keep_stdout_for_images() {
+    std::cout.rdbuf(std::cerr.rdbuf());
+}
 
-    //std::cout << point <<std::endl;
+// Prépare une scène vide avec la bibliothèque de matériaux commune et le plan en damier du sol
+void init_scene(Scene& scene, const MaterialLibrary& materials, Accelerator accelerator) {
+    scene.get_materials() = materials;
+    scene.set_accelerator(accelerator);
 
-    float diffuse_light_intensity = 0, specular_light_intensity = 0;
-    for (size_t i=0; i<lights.size(); i++) {
-        Vec3f light_dir      = (lights[i].position - point).normalize();
+    MaterialId grey_metal = 0, blue_metal = 0;
+    materials.find("grey_metal", grey_metal);
+    materials.find("blue_metal", blue_metal);
 
-        float light_distance = (lights[i].position - point).norm();
+    //DEFINITION DU PLAN EN HARD
+    scene.add_object(   new CheckerboardPlane(  Vec3f(0, 1, 0), //Normale du plan
+                                    -4,             //Distance entre l'origine (observateur) et la normale (au sens de plus petite distance entre un point du plan et l'origine)
+                                    grey_metal,     //Matériau 1 du plan
+                                    blue_metal,     //Matériau 2 du plan
+                                    2));            //Taille des cases
+}
 
-        Vec3f shadow_orig = light_dir*N < 0 ? point - N*1e-3 : point + N*1e-3; // checking if the point lies in the shadow of the lights[i]
+// Image à rendre : un fichier de configuration et les réglages de la caméra
+struct RenderJob {
+    std::string scene;
+    RenderOptions options;
+};
+
+// Lit un fichier de travaux : une ligne d'en-tête puis une image par ligne, avec les champs
+// scene;width;height;fov;output;shading séparés par ';' (fov en degrés, shading comme --shading).
+// Un champ vide ou absent garde la valeur de la ligne de commande. Une ligne dont un champ est invalide est
+// signalée et ignorée, et comptée dans invalid. Faux si le fichier ne peut pas être ouvert.
+bool load_jobs(const std::string& filename, const RenderOptions& defaults, std::vector<RenderJob>& jobs, int& invalid) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "Erreur : impossible d'ouvrir " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    getline(file, line); // skip header
 
-        Vec3f shadow_pt, shadow_N;
-        Material tmpmaterial;
-        if (scene_intersect(shadow_orig, light_dir, objects, shadow_pt, shadow_N, tmpmaterial) && (shadow_pt-shadow_orig).norm() < light_distance)
+    int line_number = 1;
+    while (getline(file, line)) {
+        line_number++;
+        if (trim(line).empty() || line[0] == '#') continue;
+        std::vector<std::string> tokens = split(line, ';');
+        tokens.resize(6);
+        for (std::string& token : tokens) token = trim(token);
+
+        RenderJob job;
+        job.scene = tokens[0];
+        job.options = defaults;
+        const char* error = nullptr;
+        if (!tokens[1].empty() && !parse_number(tokens[1], job.options.width, 1)) error = "largeur invalide";
+        else if (!tokens[2].empty() && !parse_number(tokens[2], job.options.height, 1)) error = "hauteur invalide";
+        else if (!tokens[3].empty() && !parse_fov(tokens[3], job.options.fov)) error = "angle de vue invalide";
+        else if (!tokens[5].empty() && !parse_shading_model(tokens[5], job.options.shading)) error = "modèle d'éclairage inconnu";
+        if (error != nullptr) {
+            std::cerr << filename << ", ligne " << line_number << " ignorée : " << error << std::endl;
+            invalid++;
             continue;
-        
-        
-        
-        diffuse_light_intensity  += lights[i].intensity * std::max(0.f, light_dir*N);
-        if (reflection_model == "Phong") {
-            specular_light_intensity += powf(std::max(0.f, reflect(light_dir, N)*dir), material.get_specular_exponent())*lights[i].intensity;
         }
-        if (reflection_model == "Blinn-Phong") {
-            Vec3f H = (light_dir - dir).normalize();
-            specular_light_intensity += powf(std::max(0.f, H*N), material.get_specular_exponent())*lights[i].intensity;
-        }           
-    }
-
-    if (reflection_model == "None") {
-        return material.get_diffuse_color() * diffuse_light_intensity * material.get_albedo()[0];
-    }
-    else{
-         return material.get_diffuse_color() * diffuse_light_intensity * material.get_albedo()[0] 
-            + Vec3f(1., 1., 1.)*specular_light_intensity * material.get_albedo()[1] + reflect_color*material.get_albedo()[2] + refract_color*material.get_albedo()[3];
+        if (!tokens[4].empty()) job.options.output = tokens[4];
+        jobs.push_back(job);
     }
+    return true;
 }
 
-void render(const std::vector<Object*> &objects, const std::vector<Light> &lights,char* reflection_model = "None") {
-    const int width    = 1024;
-    const int height   = 768;
-    const int fov      = M_PI/2.;
-    std::vector<Vec3f> framebuffer(width*height);
-
-    #pragma omp parallel for
-    for (size_t j = 0; j<height; j++) {
-        for (size_t i = 0; i<width; i++) {
-            float x =  (2*(i + 0.5)/(float)width  - 1)*tan(fov/2.)*width/(float)height;
-            float y = -(2*(j + 0.5)/(float)height - 1)*tan(fov/2.);
-            Vec3f dir = Vec3f(x, y, -1).normalize();
-            framebuffer[i+j*width] = cast_ray(Vec3f(0,0,0), dir, objects, lights,reflection_model);
+// Rend toutes les images dans le même processus. Les threads d'OpenMP sont créés une fois pour toutes ;
+// chaque fichier de configuration n'est lu et sa structure d'accélération construite qu'une seule fois,
+// même s'il sert à plusieurs images. Rend le nombre d'images qui n'ont pas pu être rendues.
+int run_jobs(const std::vector<RenderJob>& jobs, const MaterialLibrary& materials, Accelerator accelerator,
+             ImageWriter& writer) {
+    std::map<std::string, std::unique_ptr<Scene>> scenes;
+    int failures = 0;
+    for (size_t k = 0; k < jobs.size(); k++) {
+        const RenderJob& job = jobs[k];
+        auto it = scenes.find(job.scene);
+        if (it == scenes.end()) {
+            std::unique_ptr<Scene> scene(new Scene());
+            init_scene(*scene, materials, accelerator);
+            if (load_scene(job.scene, *scene)) {
+                scene->build();
+            } else {
+                scene.reset(); // on ne retente pas de lire le fichier pour les images suivantes
+            }
+            it = scenes.emplace(job.scene, std::move(scene)).first;
         }
-    }
-
-    std::ofstream ofs;
-    ofs.open("./images/out.ppm");
-    ofs << "P6\n" << width << " " << height << "\n255\n";
-    for (size_t i = 0; i < height*width; ++i) {
-        for (size_t j = 0; j<3; j++) {
-            ofs << (char)(255 * std::max(0.f, std::min(1.f, framebuffer[i][j])));
+        if (!it->second) {
+            failures++;
+            continue;
+        }
+        double start = omp_get_wtime();
+        if (!render(*it->second, job.options, writer)) {
+            failures++;
+            continue;
         }
+        std::cout << "Image " << k + 1 << "/" << jobs.size() << " : " << job.options.output << " ("
+                  << job.options.width << "x" << job.options.height << ", " << omp_get_wtime() - start << " s)" << std::endl;
     }
-    ofs.close();
+    return failures;
 }
 
-std::vector<std::string> split(const std::string& s, char delimiter) {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(s);
-    while (getline(tokenStream, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
+// Nom de l'image frame d'une séquence : out.ppm donne out_0000.ppm, out_0001.ppm... La sortie standard
+// reçoit les images les unes à la suite des autres.
+std::string frame_filename(const std::string& output, int frame, int frame_count) {
+    if (output == "-") return output;
+    size_t digits = std::max<size_t>(4, std::to_string(frame_count - 1).size());
+    std::string number = std::to_string(frame);
+    number.insert(0, digits - number.size(), '0');
+    size_t slash = output.find_last_of("/\\");
+    size_t dot = output.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return output + "_" + number;
+    return output.substr(0, dot) + "_" + number + output.substr(dot);
 }
 
-std::string trim(const std::string& str) {
-    size_t first = str.find_first_not_of(' ');
-    if (std::string::npos == first) {
-        return str;
+// Rend une séquence d'images. La scène n'est lue et sa structure d'accélération construite qu'une fois ;
+// entre deux images seuls les objets déplacés sont remis à jour. frame_count vaut 0 pour s'arrêter
+// à la dernière clé de l'animation.
+bool render_animation(Scene& scene, size_t first_object, Animation& animation, int frame_count,
+                      const RenderOptions& options, ImageWriter& writer) {
+    if (!animation.bind(scene, first_object)) return false;
+    if (frame_count <= 0) frame_count = animation.get_keyed_frame_count();
+    if (frame_count <= 0) {
+        std::cerr << "Erreur : l'animation n'a pas de clé, précisez le nombre d'images avec --frames" << std::endl;
+        return false;
+    }
+    RenderOptions frame_options = options;
+    if (!frame_options.checkpoint.empty()) {
+        std::cerr << "Le point de reprise est ignoré pour une animation" << std::endl;
+        frame_options.checkpoint.clear();
     }
-    size_t last = str.find_last_not_of(' ');
-    return str.substr(first, (last - first + 1));
-}
-
-void load_csv(const std::string& filename, std::vector<Object*>& objects, std::vector<Light>& lights, std::vector<std::string> mat_names, std::vector<Material> mat_values) {
-    std::ifstream file("/home/dinovico/IN204/Projet/configs/config1.csv");
-    std::string line;
-
-    getline(file, line); // skip header
-
-    while (getline(file, line)) {
-        std::vector<std::string> tokens = split(line, ';');
 
-        if(line[0] == '#') continue;
+    const double start = omp_get_wtime();
+    double update_time = 0.;
+    for (int frame = 0; frame < frame_count; frame++) {
+        const double update_start = omp_get_wtime();
+        animation.apply(scene, frame, frame_count);
+        scene.refit();
+        update_time += omp_get_wtime() - update_start;
 
-        std::string type = tokens[0];
+        frame_options.output = frame_filename(options.output, frame, frame_count);
+        if (!render(scene, frame_options, writer)) return false;
+    }
+    std::cout << frame_count << " images en " << omp_get_wtime() - start << " s, dont " << update_time
+              << " s de mise à jour de la scène" << std::endl;
+    return true;
+}
 
-        std::string center_str = tokens[1];
-        center_str.erase(remove(center_str.begin(), center_str.end(), '('), center_str.end());
-        center_str.erase(remove(center_str.begin(), center_str.end(), ')'), center_str.end());
-        std::vector<std::string> center_tokens = split(center_str, ',');
-        Vec3f center(stof(center_tokens[0]), stof(center_tokens[1]), stof(center_tokens[2]));
+// Attend que toutes les images soient écrites, puis écrit les statistiques si elles sont demandées.
+// Rend le code de sortie du programme.
+int finish(ImageWriter& writer, const std::string& stats_file, bool ok) {
+    ok = writer.wait() == 0 && ok;
+#ifdef OORT_STATS
+    if (!stats_file.empty()) ok = write_stats_json(stats_file) && ok;
+#endif
+    return ok ? 0 : 1;
+}
 
 
-        Material material(Vec3f(0,0,0), Vec4f(0,0,0,0), 0, 0);
-        if (type == "Sphere") {
-            float radius = stof(tokens[2]);
-            std::string material_str = trim(tokens[3]);
-            for(int i=0; i<mat_names.size(); i++){
-                if (material_str == mat_names[i]){
-                    material = mat_values[i];
-                }
+int main(int argc, char* argv[]) {
+
+    // Bibliothèque des matériaux, référencés par leur nom dans les fichiers de configuration.
+    // Elle est recopiée dans chaque scène, qui peut y ajouter les matériaux inconnus qu'elle rencontre.
+    MaterialLibrary materials;
+    add_default_materials(materials);
+    MaterialId ivory = 0, red_rubber = 0;
+    materials.find("ivory", ivory);
+    materials.find("red_rubber", red_rubber);
+
+    RenderOptions options;
+    Accelerator accelerator = Accelerator::BVH;
+    std::string scene_file;
+    std::string jobs_file;
+    std::string stats_file;
+    std::string animation_file;
+    int frame_count = 0;
+    bool watch = false;
+    bool valid = true; // faux si une valeur numérique est invalide
+
+    // --scene FICHIER : fichier de configuration à rendre, sans passer par la fenêtre de sélection
+    // --jobs FICHIER : fichier de travaux, plusieurs images rendues dans le même processus
+    // --width N, --height N : dimensions de l'image
+    // --fov DEGRES : angle de vue vertical, entre 0 et 180 degrés exclus
+    // --output FICHIER : image produite
+    // --format ppm|pfm : format de l'image, déduit de l'extension par défaut (utile avec --output -)
+    // --convert CSV BINAIRE : convertit un fichier de configuration au format binaire, plus rapide à relire
+    // --shading phong|blinn-phong|none : modèle d'éclairage (none : diffus seul, sans réflexions ni réfractions)
+    // --fast-shading : éclairage avec des puissances et racines approchées (écart mesuré par make shading-error)
+    // --light-samples N : lumières tirées par intersection, selon leur importance, parmi celles qui l'atteignent
+    // --no-bvh : on revient au parcours linéaire de tous les objets pour chaque rayon
+    // --soa : les objets sont compilés en tableaux par type, testés avec des noyaux vectoriels
+    // --max-depth N : profondeur maximale des rayons secondaires
+    // --min-weight W : seuil de contribution en dessous duquel un rayon secondaire n'est pas lancé
+    // --packets : rayons primaires lancés par paquets avec les noyaux vectoriels
+    // --tile-lists : rayons primaires testés contre les seuls objets dont la boîte recouvre leur tuile à l'écran
+    // --tile-size N : côté des tuiles distribuées aux threads
+    // --tile-order scanline|morton|spiral : ordre de distribution des tuiles
+    // --thread-report : temps de calcul de chaque thread
+    // --progressive : première passe grossière (un pixel sur 8) suivie de passes de raffinement
+    // --coarse-step N : écart entre les pixels de la première passe (arrondi à une puissance de 2)
+    // --time-budget S : arrête le rendu après S secondes et écrit l'image atteinte
+    // --checkpoint FICHIER : sauvegarde régulière de l'état du rendu, repris au lancement suivant
+    // --checkpoint-interval S : secondes entre deux sauvegardes
+    // --aa N : anticrénelage adaptatif avec N rayons par pixel suréchantillonné
+    // --aa-threshold T : écart de couleur entre pixels voisins qui déclenche le suréchantillonnage
+    // --aa-budget F : proportion maximale de pixels suréchantillonnés, entre 0 et 1
+    // --animation FICHIER : trajectoires des objets et des lumières, rendues en une séquence d'images numérotées
+    // --frames N : nombre d'images de la séquence, jusqu'à la dernière clé par défaut
+    // --workers N : rendu réparti entre N processus (tuiles redistribuées si un processus s'arrête)
+    // --stream N : image écrite par bandes au fil du rendu, N bandes de tuiles en mémoire (très grandes images)
+    // --gbuffer FICHIER : surfaces vues par les rayons primaires, écrites au premier rendu et relues aux suivants
+    // --watch : relit le fichier de scène à chaque modification et ne recalcule que les tuiles touchées
+    // --stats FICHIER : compteurs de rayons et de tests, temps de chaque phase, en JSON (make STATS=1)
+    // --heatmap time|rays : carte du coût de chaque pixel, écrite à côté de l'image (make STATS=1)
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--scene" && i + 1 < argc) scene_file = argv[++i];
+        else if (arg == "--convert" && i + 2 < argc) {
+            Scene scene;
+            scene.get_materials() = materials;
+            double start = omp_get_wtime();
+            if (!load_csv(argv[i + 1], scene)) return 1;
+            double parsed = omp_get_wtime();
+            if (!save_scene_binary(argv[i + 2], scene)) return 1;
+            std::cout << scene.get_objects().size() << " objets et " << scene.get_lights().size() << " lumières lus en "
+                      << parsed - start << " s, écrits dans " << argv[i + 2] << std::endl;
+            return 0;
+        }
+        else if (arg == "--jobs" && i + 1 < argc) jobs_file = argv[++i];
+        else if (arg == "--width" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.width, 1) && valid;
+        else if (arg == "--height" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.height, 1) && valid;
+        else if (arg == "--fov" && i + 1 < argc) {
+            if (!parse_fov(argv[++i], options.fov)) {
+                std::cerr << "Erreur : valeur invalide pour --fov : " << argv[i] << " (entre 0 et 180 degrés exclus)" << std::endl;
+                valid = false;
             }
-            objects.push_back(new Sphere(center, radius, material));
-        }else if (type == "Parallelepiped"){
-            std::string material_str = trim(tokens[3]);
-            for(int i=0; i<mat_names.size(); i++){
-                if (material_str == mat_names[i]){
-                    material = mat_values[i];
-                }
+        }
+        else if (arg == "--output" && i + 1 < argc) options.output = argv[++i];
+        else if (arg == "--format" && i + 1 < argc) options.format = argv[++i];
+        else if (arg == "--shading" && i + 1 < argc) {
+            std::string model(argv[++i]);
+            if (!parse_shading_model(model, options.shading)) {
+                std::cerr << "Erreur : modèle d'éclairage inconnu : " << model << std::endl;
+                valid = false;
+            }
+        }
+        else if (arg == "--fast-shading") options.fast_shading = true;
+        else if (arg == "--light-samples" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.light_samples, 0) && valid;
+        else if (arg == "--no-bvh") accelerator = Accelerator::Linear;
+        else if (arg == "--soa") accelerator = Accelerator::Compiled;
+        else if (arg == "--max-depth" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.max_depth) && valid;
+        else if (arg == "--min-weight" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.min_weight) && valid;
+        else if (arg == "--packets") options.packets = true;
+        else if (arg == "--tile-lists") options.tile_lists = true;
+        else if (arg == "--tile-size" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.tile_size, 1) && valid;
+        else if (arg == "--tile-order" && i + 1 < argc) {
+            std::string order(argv[++i]);
+            if (order == "scanline") options.tile_order = TileOrder::Scanline;
+            else if (order == "morton") options.tile_order = TileOrder::Morton;
+            else if (order == "spiral") options.tile_order = TileOrder::Spiral;
+            else {
+                std::cerr << "Erreur : ordre de tuiles inconnu : " << order << std::endl;
+                valid = false;
             }
-            std::string size_str = tokens[5];
-            size_str.erase(remove(size_str.begin(), size_str.end(), '('), size_str.end());
-            size_str.erase(remove(size_str.begin(), size_str.end(), ')'), size_str.end());
-            std::vector<std::string> size_tokens = split(size_str, ',');
-            Vec3f size(stof(size_tokens[0]), stof(size_tokens[1]), stof(size_tokens[2]));
-            float angle_x = stof(tokens[6]);
-            float angle_y = stof(tokens[7]);
-            float angle_z = stof(tokens[8]);
-            objects.push_back(new Parallelepiped(center, size, material, angle_x, angle_y, angle_z));
-
-
-        }else if (type == "Lights") {
-            float intensity = stof(tokens[4]);
-            lights.push_back(Light(center, intensity));
+        }
+        else if (arg == "--thread-report") options.thread_report = true;
+        else if (arg == "--progressive") options.coarse_step = 8;
+        else if (arg == "--coarse-step" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.coarse_step) && valid;
+        else if (arg == "--time-budget" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.time_budget, 0.) && valid;
+        else if (arg == "--checkpoint" && i + 1 < argc) options.checkpoint = argv[++i];
+        else if (arg == "--checkpoint-interval" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.checkpoint_interval) && valid;
+        else if (arg == "--aa" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.aa_samples, 0) && valid;
+        else if (arg == "--aa-threshold" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.aa_threshold) && valid;
+        else if (arg == "--aa-budget" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.aa_budget, 0.f, 1.f) && valid;
+        else if (arg == "--animation" && i + 1 < argc) animation_file = argv[++i];
+        else if (arg == "--frames" && i + 1 < argc) valid = parse_option(arg, argv[++i], frame_count) && valid;
+        else if (arg == "--workers" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.workers, 0) && valid;
+        else if (arg == "--stream" && i + 1 < argc) valid = parse_option(arg, argv[++i], options.stream_window, 0) && valid;
+        else if (arg == "--gbuffer" && i + 1 < argc) options.gbuffer = argv[++i];
+        else if (arg == "--watch") watch = true;
+        else if (arg == "--stats" && i + 1 < argc) stats_file = argv[++i];
+        else if (arg == "--heatmap" && i + 1 < argc) {
+            options.heatmap = argv[++i];
+            if (options.heatmap != "time" && options.heatmap != "rays") {
+                std::cerr << "Erreur : carte de coût inconnue : " << options.heatmap << std::endl;
+                valid = false;
+            }
+        }
+        else if (arg == "--convert") {
+            std::cerr << "Erreur : --convert attend un fichier de configuration et le fichier binaire à écrire" << std::endl;
+            if (i + 1 < argc) i++;
+            valid = false;
+        }
+        else {
+            std::cerr << "Erreur : option inconnue ou sans valeur : " << arg << std::endl;
+            valid = false;
         }
     }
-}
-
-
-int main() {
-
-    std::vector<std::string> mat_names = {"ivory", "red_rubber", "mirror", "glass", "blue_metal", "grey_metal"}; 
-    std::vector<Material> mat_values = {Material(Vec3f(0.4, 0.4, 0.3), Vec4f(0.9,  0.5, 0.1, 0.0), 50., 1.),
-                                        Material(Vec3f(0.3, 0.1, 0.1), Vec4f(1.4,  0.3, 0.0, 0.0), 10., 1.),
-                                        Material(Vec3f(1.0, 1.0, 1.0), Vec4f(0.0, 16.0, 0.8, 0.0), 1425., 1.),
-                                        Material(Vec3f(0.6, 0.7, 0.8), Vec4f(0.0,  0.9, 0.1, 0.8), 125., 1.5),
-                                        Material(Vec3f(0.05, 0.05, 0.25), Vec4f(0.7, 11.0, 0.6, 0.0), 1000., 1.),
-                                        Material(Vec3f(0.25, 0.25, 0.25), Vec4f(0.7, 11.0, 0.6, 0.0), 1000., 1.)};
+    if (!valid) return 1;
+#ifndef OORT_STATS
+    if (!stats_file.empty() || !options.heatmap.empty()) {
+        std::cerr << "Erreur : --stats et --heatmap demandent un exécutable compilé avec les statistiques (make STATS=1)" << std::endl;
+        return 1;
+    }
+#endif
+    // Les passes divisent l'écart par deux jusqu'à un pixel sur un
+    options.coarse_step = std::max(1, std::min(options.coarse_step, 128));
+    while (options.coarse_step & (options.coarse_step - 1)) options.coarse_step &= options.coarse_step - 1;
+    if (options.workers > 0 && (options.coarse_step > 1 || options.time_budget > 0. || !options.checkpoint.empty() ||
+                                options.aa_samples > 1 || !options.heatmap.empty())) {
+        std::cerr << "Avec --workers l'image est rendue en une passe : --progressive, --time-budget, --checkpoint, --aa "
+                  << "et --heatmap sont ignorés" << std::endl;
+    }
+    if (options.workers > 0 && options.stream_window > 0) {
+        std::cerr << "--stream est ignoré avec --workers" << std::endl;
+        options.stream_window = 0;
+    }
+    if (!options.gbuffer.empty() && (options.workers > 0 || options.stream_window > 0)) {
+        std::cerr << "--gbuffer est ignoré avec --workers et --stream" << std::endl;
+        options.gbuffer.clear();
+    }
+    if (!options.gbuffer.empty() && (options.coarse_step > 1 || options.time_budget > 0. || !options.checkpoint.empty() ||
+                                     !options.heatmap.empty())) {
+        std::cerr << "Avec --gbuffer l'image est rendue en une passe : --progressive, --time-budget, --checkpoint "
+                  << "et --heatmap sont ignorés" << std::endl;
+    }
+    if (options.tile_lists && (options.workers > 0 || !options.gbuffer.empty())) {
+        std::cerr << "--tile-lists est ignoré avec --workers et --gbuffer" << std::endl;
+        options.tile_lists = false;
+    }
+    if (options.stream_window > 0 && (options.coarse_step > 1 || options.time_budget > 0. || !options.checkpoint.empty() ||
+                                      options.aa_samples > 1 || !options.heatmap.empty())) {
+        std::cerr << "Avec --stream l'image est rendue en une passe : --progressive, --time-budget, --checkpoint, --aa "
+                  << "et --heatmap sont ignorés" << std::endl;
+    }
 
+    if (watch && (!jobs_file.empty() || !animation_file.empty())) {
+        std::cerr << "--watch est ignoré avec --jobs et --animation" << std::endl;
+        watch = false;
+    }
+    if (watch && (options.workers > 0 || options.stream_window > 0 || !options.gbuffer.empty() || options.coarse_step > 1 ||
+                  options.time_budget > 0. || !options.checkpoint.empty() || options.aa_samples > 1 || !options.heatmap.empty())) {
+        std::cerr << "Avec --watch l'image est rendue en une passe : --workers, --stream, --gbuffer, --progressive, "
+                  << "--time-budget, --checkpoint, --aa et --heatmap sont ignorés" << std::endl;
+    }
 
+    std::vector<RenderJob> jobs;
+    int invalid_jobs = 0;
+    if (!jobs_file.empty() && !load_jobs(jobs_file, options, jobs, invalid_jobs)) return 1;
+    if (options.output == "-") keep_stdout_for_images();
+    for (const RenderJob& job : jobs) {
+        if (job.options.output == "-") keep_stdout_for_images();
+    }
 
-    std::vector<Object*> objects;
-    std::vector<Light>  lights;
+    if (options.packets) {
+        std::cout << "Paquets de " << PACKET_SIZE << " rayons, jeu d'instructions : " << packet_isa() << std::endl;
+    }
 
-    //DEFINITION DU PLAN EN HARD
+    ImageWriter writer;
 
-    
-    objects.push_back(  new CheckerboardPlane(  Vec3f(0, 1, 0), //Normale du plan
-                                    -4,             //Distance entre l'origine (observateur) et la normale (au sens de plus petite distance entre un point du plan et l'origine)
-                                    mat_values[5],  //Matériau 1 du plan
-                                    mat_values[4],  //Matériau 2 du plan
-                                    2));            //Taille des cases
-    
+    if (!jobs_file.empty()) {
+        int failures = invalid_jobs + run_jobs(jobs, materials, accelerator, writer);
+        return finish(writer, stats_file, failures == 0);
+    }
 
-    //objects.push_back(new Parallelepiped(Vec3f(0, 2, -10), Vec3f(2.,2.,2.), mat_values[0]));
-    
+    // Sans fichier donné en argument, on le demande à l'utilisateur
+    if (scene_file.empty()) {
     #ifdef __linux__
 
         FILE *fp;
@@ -251,21 +454,14 @@ int main() {
             return 1;
         }
 
-        fgets(filename, 1024, fp);
+        if (fgets(filename, 1024, fp) != NULL) {
+            scene_file = trim(std::string(filename).substr(0, strcspn(filename, "\r\n")));
+        }
 
         pclose(fp);
 
+        std::cout << scene_file << std::endl;
 
-
-        std::cout << filename << std::endl;
-
-        
-        std::string fullPath(filename);
-
-
-        load_csv(fullPath, objects, lights, mat_names, mat_values);
-        render(objects, lights,"Phong");
-    
     #elif _WIN32
 
         // Utiliser la fonction de Windows pour demander à l'utilisateur de sélectionner un fichier
@@ -284,14 +480,37 @@ int main() {
 
         if (GetOpenFileName(&ofn)) {
             std::cout << "Chemin d'accès au fichier : " << filename << std::endl;
-            load_csv(filename, objects, lights, mat_names, mat_values);
-            render(objects, lights,"Phong");
+            scene_file = filename;
         }
 
     #elif __APPLE__
-        std::cout << "OS non supporté, veuillez saisir le fichier manuellement" << std::endl;
+        std::cout << "OS non supporté, utilisez l'option --scene ou saisissez le fichier manuellement" << std::endl;
       
     #endif
+    }
+
+    Scene scene;
+    init_scene(scene, materials, accelerator);
+
+    if (!scene_file.empty() && watch) {
+        auto load = [&](Scene& watched) {
+            init_scene(watched, materials, accelerator);
+            return load_scene(scene_file, watched);
+        };
+        if (!watch_scene(scene_file, load, options, writer)) return 1;
+    } else if (!scene_file.empty()) {
+        // Les objets ajoutés avant ceux du fichier (le sol) ne sont pas numérotés dans l'animation
+        const size_t first_object = scene.get_objects().size();
+        Animation animation;
+        if (!animation_file.empty() && !load_animation(animation_file, animation)) return 1;
+        if (!load_scene(scene_file, scene)) return 1;
+        scene.build();
+        if (!animation_file.empty()) {
+            if (!render_animation(scene, first_object, animation, frame_count, options, writer)) return finish(writer, stats_file, false);
+        } else if (!render(scene, options, writer)) {
+            return finish(writer, stats_file, false);
+        }
+    }
     
     // Si le code prècédent ne marche pas sur votre système d'exploitation mettre en commentaire les #ifdef et 
     // décommenter le code ci-dessous
@@ -300,23 +519,24 @@ int main() {
     /*
 
     // On rajoute des Objets
-    objects.push_back(new Sphere(Vec3f(-3, 0, -16), 2, ivory));
-    objects.push_back(new Sphere(Vec3f(-1.0, -1.5, -12), 2, red_rubber));
-    objects.push_back(new Sphere(Vec3f(1.5, -0.5, -18), 3, red_rubber));
-    objects.push_back(new Sphere(Vec3f(7, 5, -18), 4, ivory));
+    scene.add_object(new Sphere(Vec3f(-3, 0, -16), 2, ivory));
+    scene.add_object(new Sphere(Vec3f(-1.0, -1.5, -12), 2, red_rubber));
+    scene.add_object(new Sphere(Vec3f(1.5, -0.5, -18), 3, red_rubber));
+    scene.add_object(new Sphere(Vec3f(7, 5, -18), 4, ivory));
 
     // On rajoute des lumières
-    lights.push_back(Light(Vec3f(-20, 20, 20), 1.5));
+    scene.add_light(Light(Vec3f(-20, 20, 20), 1.5));
 
     // On rajoute un plan
-    objects.push_back(new Plane(Vec3f(0, 1, 0), -4, ivory));
+    scene.add_object(new Plane(Vec3f(0, 1, 0), -4, ivory));
 
-    // On lance le rendu
-    render(objects, lights,"Phong");
+    // On construit la BVH puis on lance le rendu
+    scene.build();
+    render(scene, options, writer);
 
     */
 
 
 
-    return 0;
+    return finish(writer, stats_file, true);
 }
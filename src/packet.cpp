@@ -0,0 +1,138 @@
+#include <cmath>
+#include <algorithm>
+
+#include "packet.hpp"
+#include "simd.hpp"
+
+// Les calculs sont écrits dans le même ordre que les versions scalaires des objets pour donner les mêmes distances.
+
+
+OORT_MULTIVERSION
+void packet_prepare(RayPacket& packet) {
+    #pragma omp simd
+    for (int k = 0; k < PACKET_SIZE; k++) {
+        packet.inv_dx[k] = 1.f / packet.dx[k];
+        packet.inv_dy[k] = 1.f / packet.dy[k];
+        packet.inv_dz[k] = 1.f / packet.dz[k];
+    }
+}
+
+OORT_MULTIVERSION
+void packet_primary_rays(RayPacket& packet, int i0, int i_end, int j, int width, int height, double tan_half_fov) {
+    const float y = -(2*(j + 0.5)/(float)height - 1)*tan_half_fov;
+    #pragma omp simd
+    for (int k = 0; k < PACKET_SIZE; k++) {
+        int i = i0 + k;
+        float x = (2*(i + 0.5)/(float)width - 1)*tan_half_fov*width/(float)height;
+        float inv_norm = 1.f / std::sqrt(x*x + y*y + 1.f);
+        packet.ox[k] = 0.f;
+        packet.oy[k] = 0.f;
+        packet.oz[k] = 0.f;
+        packet.dx[k] = x*inv_norm;
+        packet.dy[k] = y*inv_norm;
+        packet.dz[k] = -1.f*inv_norm;
+        packet.t[k] = i < i_end ? std::numeric_limits<float>::max() : 0.f;
+        packet.object[k] = PACKET_NO_HIT;
+    }
+    packet_prepare(packet);
+}
+
+OORT_MULTIVERSION
+void packet_intersect_sphere(RayPacket& packet, float cx, float cy, float cz, float radius, int32_t id) {
+    const float r2 = radius*radius;
+    #pragma omp simd
+    for (int k = 0; k < PACKET_SIZE; k++) {
+        float Lx = cx - packet.ox[k], Ly = cy - packet.oy[k], Lz = cz - packet.oz[k];
+        float tca = Lz*packet.dz[k] + Ly*packet.dy[k] + Lx*packet.dx[k];
+        float d2 = Lz*Lz + Ly*Ly + Lx*Lx - tca*tca;
+        float thc = sqrtf(lane_max(0.f, r2 - d2));
+        float t0 = tca - thc;
+        float t1 = tca + thc;
+        t0 = t0 < 0.f ? t1 : t0;
+        bool hit = !(d2 > r2) & (t0 >= 0.f) & (t0 < packet.t[k]);
+        packet.t[k] = hit ? t0 : packet.t[k];
+        packet.object[k] = hit ? id : packet.object[k];
+    }
+}
+
+OORT_MULTIVERSION
+void packet_intersect_plane(RayPacket& packet, float nx, float ny, float nz, float distance, int32_t id) {
+    const float px = nx*distance, py = ny*distance, pz = nz*distance;
+    #pragma omp simd
+    for (int k = 0; k < PACKET_SIZE; k++) {
+        float denom = nz*packet.dz[k] + ny*packet.dy[k] + nx*packet.dx[k];
+        float t0 = ((pz - packet.oz[k])*nz + (py - packet.oy[k])*ny + (px - packet.ox[k])*nx) / denom;
+        bool hit = (std::abs(denom) > 1e-6) & (t0 >= 0.f) & (t0 < packet.t[k]);
+        packet.t[k] = hit ? t0 : packet.t[k];
+        packet.object[k] = hit ? id : packet.object[k];
+    }
+}
+
+OORT_MULTIVERSION
+void packet_intersect_parallelepiped(RayPacket& packet, const float position[3], const float basis[9],
+                                     const float half_size[3], int32_t id) {
+    const float bxx = basis[0], bxy = basis[1], bxz = basis[2];
+    const float byx = basis[3], byy = basis[4], byz = basis[5];
+    const float bzx = basis[6], bzy = basis[7], bzz = basis[8];
+    const float hx = half_size[0], hy = half_size[1], hz = half_size[2];
+    #pragma omp simd
+    for (int k = 0; k < PACKET_SIZE; k++) {
+        // Passage dans le repère local du parallélépipède
+        float vx = packet.ox[k] - position[0], vy = packet.oy[k] - position[1], vz = packet.oz[k] - position[2];
+        float lox = vz*bxz + vy*bxy + vx*bxx;
+        float loy = vz*byz + vy*byy + vx*byx;
+        float loz = vz*bzz + vy*bzy + vx*bzx;
+        float ldx = packet.dz[k]*bxz + packet.dy[k]*bxy + packet.dx[k]*bxx;
+        float ldy = packet.dz[k]*byz + packet.dy[k]*byy + packet.dx[k]*byx;
+        float ldz = packet.dz[k]*bzz + packet.dy[k]*bzy + packet.dx[k]*bzx;
+
+        // Méthode des slabs, sans branchement
+        float a = (-lox - hx) / ldx, b = (-lox + hx) / ldx;
+        float tmin = a > b ? b : a, tmax = a > b ? a : b;
+        a = (-loy - hy) / ldy; b = (-loy + hy) / ldy;
+        float tymin = a > b ? b : a, tymax = a > b ? a : b;
+        bool hit = !((tmin > tymax) | (tymin > tmax));
+        tmin = tymin > tmin ? tymin : tmin;
+        tmax = tymax < tmax ? tymax : tmax;
+        a = (-loz - hz) / ldz; b = (-loz + hz) / ldz;
+        float tzmin = a > b ? b : a, tzmax = a > b ? a : b;
+        hit = hit & !((tmin > tzmax) | (tzmin > tmax));
+        tmin = tzmin > tmin ? tzmin : tmin;
+        tmax = tzmax < tmax ? tzmax : tmax;
+
+        float t0 = tmin < 0.f ? tmax : tmin;
+        hit = hit & (t0 >= 0.f) & (t0 < packet.t[k]);
+        packet.t[k] = hit ? t0 : packet.t[k];
+        packet.object[k] = hit ? id : packet.object[k];
+    }
+}
+
+OORT_MULTIVERSION
+bool packet_intersect_aabb(const RayPacket& packet, const float box_min[3], const float box_max[3], float& t_entry) {
+    const float minx = box_min[0], miny = box_min[1], minz = box_min[2];
+    const float maxx = box_max[0], maxy = box_max[1], maxz = box_max[2];
+    float entry[PACKET_SIZE];
+    #pragma omp simd
+    for (int k = 0; k < PACKET_SIZE; k++) {
+        float tx1 = (minx - packet.ox[k]) * packet.inv_dx[k], tx2 = (maxx - packet.ox[k]) * packet.inv_dx[k];
+        float ty1 = (miny - packet.oy[k]) * packet.inv_dy[k], ty2 = (maxy - packet.oy[k]) * packet.inv_dy[k];
+        float tz1 = (minz - packet.oz[k]) * packet.inv_dz[k], tz2 = (maxz - packet.oz[k]) * packet.inv_dz[k];
+        float t0 = lane_max(0.f, lane_max(lane_min(tx1, tx2), lane_max(lane_min(ty1, ty2), lane_min(tz1, tz2))));
+        float t1 = lane_min(packet.t[k], lane_min(lane_max(tx1, tx2), lane_min(lane_max(ty1, ty2), lane_max(tz1, tz2))));
+        // Les rayons qui ratent la boîte reçoivent une distance d'entrée infinie
+        entry[k] = t0 <= t1 ? t0 : std::numeric_limits<float>::infinity();
+    }
+    float closest = std::numeric_limits<float>::infinity();
+    for (int k = 0; k < PACKET_SIZE; k++) closest = std::min(closest, entry[k]);
+    t_entry = closest;
+    return closest != std::numeric_limits<float>::infinity();
+}
+
+const char* packet_isa() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return "avx512f";
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+    return "default";
+}
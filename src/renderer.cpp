@@ -0,0 +1,821 @@
+#include <limits>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <omp.h>
+
+#include "renderer.hpp"
+#include "packet.hpp"
+#include "progressive.hpp"
+#include "distributed.hpp"
+#include "gbuffer.hpp"
+#include "scene_description.hpp"
+#include "tile_lists.hpp"
+#include "fast_math.hpp"
+#include "stats.hpp"
+
+
+bool scene_intersect(const Vec3f &orig, const Vec3f &dir, const Scene &scene, Hit &hit) {
+    return scene.intersect(orig, dir, hit) && hit.t < MAX_RAY_DISTANCE;
+}
+
+Vec3f reflect(const Vec3f &I, const Vec3f &N) {
+    return I - N*2.f*(I*N);
+}
+
+Vec3f refract(const Vec3f &I, const Vec3f &N, const float &refractive_index) { // implémentation de la loi de Snell
+    float cosi = - std::max(-1.f, std::min(1.f, I*N));
+    float etai = 1, etat = refractive_index;
+    Vec3f n = N;
+    if (cosi < 0) { // si le rayon est à l'intérieur de l'objet, on échange les indices et on inverse la normale pour obtenir le résultat correct
+        cosi = -cosi;
+        std::swap(etai, etat); n = -N;
+    }
+    float eta = etai / etat;
+    float k = 1 - eta*eta*(1 - cosi*cosi);
+    return k < 0 ? Vec3f(0,0,0) : I*eta + n*(eta * cosi - sqrtf(k));
+}
+
+
+// Profondeur maximale acceptée : la pile de rayons en attente est de taille fixe
+static const size_t MAX_TRACE_DEPTH = 62;
+
+// Rayon en attente de traitement. weight est le produit des albédos traversés depuis le rayon primaire :
+// c'est le poids de sa couleur dans celle du pixel.
+struct PendingRay {
+    Vec3f orig;
+    Vec3f dir;
+    float weight;
+    size_t depth;
+};
+
+bool parse_shading_model(const std::string &name, ShadingModel &model) {
+    if (name == "phong") model = ShadingModel::Phong;
+    else if (name == "blinn-phong") model = ShadingModel::BlinnPhong;
+    else if (name == "none") model = ShadingModel::None;
+    else return false;
+    return true;
+}
+
+// Éclairage rapide par une lumière de direction unitaire light_dir, à la distance light_distance. Les termes
+// diffus et spéculaire sont calculés avant le rayon d'ombre, qui n'est pas lancé si la lumière n'apporte
+// rien. Seul le terme spéculaire est approché : puissance de SpecularPower, et demi-vecteur de Blinn-Phong
+// normalisé par fast_rsqrt.
+template <ShadingModel MODEL>
+static inline void shade_light_fast(const Scene &scene, const Vec3f &light_dir, float light_distance, float intensity,
+                                    const Vec3f &point, const Vec3f &N, const Vec3f &dir, const Material &material,
+                                    float &diffuse_light_intensity, float &specular_light_intensity) {
+    const float diffuse = std::max(0.f, light_dir*N);
+    float specular = 0.f;
+    if (MODEL == ShadingModel::Phong) specular = material.get_specular_power()(std::max(0.f, reflect(light_dir, N)*dir));
+    if (MODEL == ShadingModel::BlinnPhong) specular = material.get_specular_power()(std::max(0.f, fast_normalize(light_dir - dir)*N));
+    if (diffuse == 0.f && specular == 0.f) return;
+
+    Vec3f shadow_orig = light_dir*N < 0 ? point - N*1e-3 : point + N*1e-3;
+    OORT_STAT(ShadowRays);
+    if (scene.occluded(shadow_orig, light_dir, 0.f, std::min(light_distance, MAX_RAY_DISTANCE)))
+        return;
+    diffuse_light_intensity  += intensity*diffuse;
+    specular_light_intensity += specular*intensity;
+}
+
+// Ajoute l'éclairage direct du point par une lumière d'intensité donnée, si rien ne la cache.
+// Avec FAST, le vecteur vers la lumière et sa longueur ne sont calculés qu'une fois. Ils restent exacts :
+// une direction approchée ferait passer des rayons d'ombre rasants d'un côté à l'autre d'un obstacle.
+template <ShadingModel MODEL, bool FAST>
+static inline void shade_light(const Scene &scene, const Vec3f &light_position, float intensity, const Vec3f &point,
+                               const Vec3f &N, const Vec3f &dir, const Material &material,
+                               float &diffuse_light_intensity, float &specular_light_intensity) {
+    if (FAST) {
+        Vec3f to_light = light_position - point;
+        const float light_distance = to_light.norm();
+        shade_light_fast<MODEL>(scene, to_light*(1.f/light_distance), light_distance, intensity, point, N, dir,
+                                material, diffuse_light_intensity, specular_light_intensity);
+        return;
+    }
+    Vec3f light_dir      = (light_position - point).normalize();
+
+    float light_distance = (light_position - point).norm();
+
+    Vec3f shadow_orig = light_dir*N < 0 ? point - N*1e-3 : point + N*1e-3; // checking if the point lies in the shadow of the light
+
+    // Il suffit d'un obstacle entre le point et la lumière, inutile de chercher le plus proche
+    OORT_STAT(ShadowRays);
+    if (scene.occluded(shadow_orig, light_dir, 0.f, std::min(light_distance, MAX_RAY_DISTANCE)))
+        return;
+
+    diffuse_light_intensity  += intensity * std::max(0.f, light_dir*N);
+    if (MODEL == ShadingModel::Phong) {
+        specular_light_intensity += powf(std::max(0.f, reflect(light_dir, N)*dir), material.get_specular_exponent())*intensity;
+    }
+    if (MODEL == ShadingModel::BlinnPhong) {
+        Vec3f H = (light_dir - dir).normalize();
+        specular_light_intensity += powf(std::max(0.f, H*N), material.get_specular_exponent())*intensity;
+    }
+}
+
+// Nombre pseudo-aléatoire dans [0, 1) tiré d'un entier (hachage lowbias32)
+static inline float hash_to_unit(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return (x >> 8) * (1.f / 16777216.f);
+}
+
+// Les lumières dont la contribution est tournée vers l'arrière de la surface gardent une petite importance :
+// elles peuvent encore donner un reflet, et toute lumière qui contribue doit pouvoir être tirée
+static const float LIGHT_IMPORTANCE_FLOOR = 0.1f;
+
+// Éclairage direct par les lumières qui atteignent le point (LightTree). Avec options.light_samples > 0 et
+// plus de lumières candidates que d'échantillons, seules light_samples lumières sont tirées, chacune avec
+// une probabilité proportionnelle à son éclairement sans ombre ; leur contribution est divisée par cette
+// probabilité pour que la moyenne reste celle de la somme complète. Les tirages ne dépendent que du point
+// éclairé : l'image ne change ni avec le nombre de threads ni avec le découpage en tuiles.
+// Avec FAST, le vecteur vers chaque lumière et sa distance, calculés pour son importance, sont réutilisés.
+template <ShadingModel MODEL, bool FAST>
+static void shade_light_tree(const Scene &scene, const RenderOptions &options, const Vec3f &point, const Vec3f &N,
+                             const Vec3f &dir, const Material &material,
+                             float &diffuse_light_intensity, float &specular_light_intensity) {
+    const std::vector<Light> &lights = scene.get_lights();
+    // Tampons réutilisés d'une intersection à l'autre par chaque thread
+    static thread_local std::vector<uint32_t> candidates;
+    static thread_local std::vector<float> intensities, cumulated, distances;
+    static thread_local std::vector<Vec3f> directions;
+    candidates.clear();
+    intensities.clear();
+    cumulated.clear();
+    distances.clear();
+    directions.clear();
+    float total = 0.f;
+    scene.get_light_tree().lights_at(point, [&](uint32_t i) {
+        Vec3f to_light = lights[i].position - point;
+        const float distance = to_light.norm();
+        const float intensity = lights[i].intensity*lights[i].attenuation(distance);
+        if (intensity == 0.f) return;
+        candidates.push_back(i);
+        intensities.push_back(intensity);
+        if (FAST) {
+            distances.push_back(distance);
+            directions.push_back(to_light*(1.f/distance));
+        }
+        total += std::abs(intensity)*(LIGHT_IMPORTANCE_FLOOR + std::max(0.f, to_light*N/distance));
+        cumulated.push_back(total);
+    });
+
+    const size_t samples = static_cast<size_t>(std::max(0, options.light_samples));
+    if (samples == 0 || candidates.size() <= samples) {
+        for (size_t k = 0; k < candidates.size(); k++) {
+            if (FAST) {
+                shade_light_fast<MODEL>(scene, directions[k], distances[k], intensities[k], point, N, dir, material,
+                                        diffuse_light_intensity, specular_light_intensity);
+            } else {
+                shade_light<MODEL, false>(scene, lights[candidates[k]].position, intensities[k], point, N, dir, material,
+                                          diffuse_light_intensity, specular_light_intensity);
+            }
+        }
+        return;
+    }
+
+    uint32_t seed = 2166136261u;
+    for (size_t c = 0; c < 3; c++) {
+        uint32_t bits;
+        std::memcpy(&bits, &point[c], sizeof(bits));
+        seed = (seed ^ bits)*16777619u;
+    }
+    for (size_t s = 0; s < samples; s++) {
+        const float u = hash_to_unit(seed + static_cast<uint32_t>(s)*0x9e3779b9u)*total;
+        const size_t k = std::min<size_t>(std::upper_bound(cumulated.begin(), cumulated.end(), u) - cumulated.begin(),
+                                          candidates.size() - 1);
+        const float probability = (cumulated[k] - (k > 0 ? cumulated[k - 1] : 0.f))/total;
+        if (FAST) {
+            shade_light_fast<MODEL>(scene, directions[k], distances[k], intensities[k]/(samples*probability), point, N, dir,
+                                    material, diffuse_light_intensity, specular_light_intensity);
+        } else {
+            shade_light<MODEL, false>(scene, lights[candidates[k]].position, intensities[k]/(samples*probability), point, N,
+                                      dir, material, diffuse_light_intensity, specular_light_intensity);
+        }
+    }
+}
+
+// Lancer d'un rayon spécialisé à la compilation pour un modèle d'éclairage, pour la présence de réflexions
+// et de réfractions dans la scène, pour la recherche des lumières (toutes, ou celles du LightTree) et pour
+// l'éclairage exact ou rapide (FAST) : la boucle de traitement des intersections ne teste ni le modèle ni
+// les branches absentes. La version à utiliser est choisie une fois pour toutes par select_trace.
+// primary_hit permet de fournir l'intersection du premier rayon quand elle a déjà été calculée (paquets de rayons),
+// primary_sample sa surface quand elle est relue dans le G-buffer
+template <ShadingModel MODEL, bool REFLECTIONS, bool REFRACTIONS, bool LIGHT_TREE, bool FAST>
+static Vec3f trace(const Vec3f &orig, const Vec3f &dir, const Scene &scene, const RenderOptions &options,
+                   const Hit *primary_hit, const GBufferSample *primary_sample) {
+    const std::vector<Light> &lights = scene.get_lights();
+    const Vec3f background(0.3, 0.3, 0.3); // fond gris
+    const size_t max_depth = std::min(options.max_depth, MAX_TRACE_DEPTH);
+
+    // Parcours en profondeur de l'arbre des rayons : au plus un rayon frère en attente par niveau
+    PendingRay stack[MAX_TRACE_DEPTH + 2];
+    size_t stack_size = 0;
+    stack[stack_size++] = {orig, dir, 1.f, 0};
+    OORT_STAT(PrimaryRays);
+
+    Vec3f color(0, 0, 0);
+    while (stack_size > 0) {
+        const PendingRay ray = stack[--stack_size];
+        OORT_STAT_DEPTH(ray.depth);
+        Vec3f point, N;
+        MaterialId material_id;
+        if (primary_sample != nullptr) {
+            // Surface du premier rayon relue dans le G-buffer
+            const bool found = primary_sample->object != GBufferSample::NO_OBJECT;
+            point = primary_sample->point;
+            N = primary_sample->normal;
+            material_id = primary_sample->material;
+            primary_sample = nullptr;
+            if (!found) {
+                color = color + background*ray.weight;
+                continue;
+            }
+        } else {
+            Hit hit;
+            bool found;
+            if (primary_hit != nullptr) {
+                hit = *primary_hit;
+                found = hit.t < MAX_RAY_DISTANCE;
+                primary_hit = nullptr;
+            } else {
+                found = scene_intersect(ray.orig, ray.dir, scene, hit);
+            }
+
+            if (!found) {
+                color = color + background*ray.weight;
+                continue;
+            }
+
+            // Le point, la normale et le matériau ne sont calculés qu'une fois, pour l'objet retenu par le parcours
+            const Object* object = scene.get_objects()[hit.object];
+            point = ray.orig + ray.dir*hit.t;
+            object->get_surface(ray.orig, ray.dir, hit.t, N, material_id);
+        }
+        const Material &material = scene.get_materials().get(material_id);
+        const Vec4f albedo = material.get_albedo();
+
+        float diffuse_light_intensity = 0, specular_light_intensity = 0;
+        if (LIGHT_TREE) {
+            shade_light_tree<MODEL, FAST>(scene, options, point, N, ray.dir, material, diffuse_light_intensity, specular_light_intensity);
+        } else {
+            for (size_t i=0; i<lights.size(); i++) {
+                shade_light<MODEL, FAST>(scene, lights[i].position, lights[i].intensity, point, N, ray.dir, material,
+                                   diffuse_light_intensity, specular_light_intensity);
+            }
+        }
+
+        Vec3f local_color = material.get_diffuse_color() * diffuse_light_intensity * albedo[0];
+        if (MODEL == ShadingModel::None) {
+            color = color + local_color*ray.weight;
+            continue;
+        }
+        color = color + (local_color + Vec3f(1., 1., 1.)*specular_light_intensity * albedo[1])*ray.weight;
+        // Sans matériau réfléchissant ni transparent, les rayons secondaires auraient un poids nul
+        if (!REFLECTIONS && !REFRACTIONS) continue;
+
+        // Au-delà de la profondeur maximale les rayons secondaires voient directement le fond
+        float reflect_weight = REFLECTIONS ? ray.weight*albedo[2] : 0.f;
+        float refract_weight = REFRACTIONS ? ray.weight*albedo[3] : 0.f;
+        if (ray.depth + 1 > max_depth) {
+            color = color + background*(reflect_weight + refract_weight);
+            continue;
+        }
+
+        // Les rayons secondaires ne sont lancés que si leur contribution n'est pas négligeable
+        if (REFRACTIONS && refract_weight > options.min_weight) {
+            Vec3f refract_dir = refract(ray.dir, N, material.get_refractive_index()).normalize();
+            Vec3f refract_orig = refract_dir*N < 0 ? point - N*1e-3 : point + N*1e-3;
+            stack[stack_size++] = {refract_orig, refract_dir, refract_weight, ray.depth + 1};
+            OORT_STAT(RefractionRays);
+        }
+        if (REFLECTIONS && reflect_weight > options.min_weight) {
+            Vec3f reflect_dir = reflect(ray.dir, N).normalize();
+            Vec3f reflect_orig = reflect_dir*N < 0 ? point - N*1e-3 : point + N*1e-3; // offset the original point to avoid occlusion by the object itself
+            stack[stack_size++] = {reflect_orig, reflect_dir, reflect_weight, ray.depth + 1};
+            OORT_STAT(ReflectionRays);
+        }
+    }
+    return color;
+}
+
+typedef Vec3f (*TraceFunction)(const Vec3f &orig, const Vec3f &dir, const Scene &scene, const RenderOptions &options,
+                               const Hit *primary_hit, const GBufferSample *primary_sample);
+
+template <ShadingModel MODEL, bool REFLECTIONS, bool REFRACTIONS>
+static TraceFunction select_trace(bool light_tree, bool fast) {
+    if (fast) {
+        return light_tree ? &trace<MODEL, REFLECTIONS, REFRACTIONS, true, true> : &trace<MODEL, REFLECTIONS, REFRACTIONS, false, true>;
+    }
+    return light_tree ? &trace<MODEL, REFLECTIONS, REFRACTIONS, true, false> : &trace<MODEL, REFLECTIONS, REFRACTIONS, false, false>;
+}
+
+template <ShadingModel MODEL>
+static TraceFunction select_trace(bool reflections, bool refractions, bool light_tree, bool fast) {
+    if (reflections) {
+        return refractions ? select_trace<MODEL, true, true>(light_tree, fast) : select_trace<MODEL, true, false>(light_tree, fast);
+    }
+    return refractions ? select_trace<MODEL, false, true>(light_tree, fast) : select_trace<MODEL, false, false>(light_tree, fast);
+}
+
+// Version de trace adaptée au modèle d'éclairage des options et aux matériaux de la scène. Les réflexions
+// (ou réfractions) ne sont compilées que si un matériau au moins a un albédo réfléchi (ou réfracté) non nul.
+// Les lumières passent par le LightTree dès que l'une d'elles a un rayon d'influence ou qu'un nombre
+// d'échantillons est demandé ; sinon toutes sont parcourues, comme avant. L'éclairage rapide n'est utilisé
+// que s'il est demandé (options.fast_shading).
+static TraceFunction select_trace(const Scene &scene, const RenderOptions &options) {
+    const MaterialLibrary &materials = scene.get_materials();
+    bool reflections = false, refractions = false;
+    for (size_t id = 0; id < materials.size(); id++) {
+        const Vec4f albedo = materials.get(static_cast<MaterialId>(id)).get_albedo();
+        reflections = reflections || albedo[2] != 0.f;
+        refractions = refractions || albedo[3] != 0.f;
+    }
+    const bool light_tree = scene.get_light_tree().has_bounded() || options.light_samples > 0;
+    switch (options.shading) {
+        case ShadingModel::Phong:
+            return select_trace<ShadingModel::Phong>(reflections, refractions, light_tree, options.fast_shading);
+        case ShadingModel::BlinnPhong:
+            return select_trace<ShadingModel::BlinnPhong>(reflections, refractions, light_tree, options.fast_shading);
+        case ShadingModel::None: break;
+    }
+    return select_trace<ShadingModel::None, false, false>(light_tree, options.fast_shading);
+}
+
+Vec3f cast_ray(const Vec3f &orig, const Vec3f &dir, const Scene &scene, const RenderOptions &options,
+               const Hit *primary_hit) {
+    return select_trace(scene, options)(orig, dir, scene, options, primary_hit, nullptr);
+}
+
+// Direction du rayon primaire qui passe par le point (i + dx, j + dy) de l'image, le centre du pixel par défaut
+Vec3f primary_ray_dir(int i, int j, int width, int height, double tan_half_fov, double dx, double dy) {
+    float x =  (2*(i + dx)/(float)width  - 1)*tan_half_fov*width/(float)height;
+    float y = -(2*(j + dy)/(float)height - 1)*tan_half_fov;
+    return Vec3f(x, y, -1).normalize();
+}
+
+// Couleur vue à travers le pixel (i, j)
+static Vec3f cast_primary_ray(const Scene &scene, const RenderOptions &options, TraceFunction trace,
+                       int i, int j, int width, int height, double tan_half_fov) {
+    return trace(Vec3f(0,0,0), primary_ray_dir(i, j, width, height, tan_half_fov), scene, options, nullptr, nullptr);
+}
+
+// Valeur de object_ids pour un pixel qui ne voit que le fond
+static const uint32_t NO_OBJECT = std::numeric_limits<uint32_t>::max();
+
+// Coût de calcul de chaque pixel (--heatmap) : temps écoulé ou nombre de rayons lancés par le thread.
+// Sans OORT_STATS les méthodes sont vides et le compilateur les supprime.
+class CostMap {
+public:
+#ifdef OORT_STATS
+    CostMap(const std::string &mode, int width, int height)
+        : m_rays(mode == "rays"), m_cost(mode.empty() ? 0 : static_cast<size_t>(height)*width, 0.f) {}
+
+    bool enabled() const { return !m_cost.empty(); }
+    // Valeur de référence avant un calcul, puis coût du calcul depuis cette référence
+    double start() const {
+        if (!enabled()) return 0.;
+        return m_rays ? static_cast<double>(thread_stats().get_counters().rays()) : omp_get_wtime();
+    }
+    float since(double start) const { return enabled() ? static_cast<float>(this->start() - start) : 0.f; }
+    void set(size_t pixel, float cost) { if (enabled()) m_cost[pixel] = cost; }
+    void add(size_t pixel, float cost) { if (enabled()) m_cost[pixel] += cost; }
+    const std::vector<float> &get_cost() const { return m_cost; }
+
+private:
+    bool m_rays;
+    std::vector<float> m_cost;
+#else
+    CostMap(const std::string &, int, int) {}
+    bool enabled() const { return false; }
+    double start() const { return 0.; }
+    float since(double) const { return 0.f; }
+    void set(size_t, float) {}
+    void add(size_t, float) {}
+#endif
+};
+
+// Anticrénelage adaptatif. Un pixel est suréchantillonné quand il voit un autre objet qu'un de ses
+// quatre voisins, ou quand sa couleur affichée en diffère de plus de aa_threshold sur une composante.
+// Si plus de aa_budget pixels (en proportion de l'image) sont retenus, on garde les plus contrastés.
+// Chaque pixel retenu est remplacé par la moyenne de aa_samples rayons répartis sur une grille régulière.
+// Rend le nombre de pixels suréchantillonnés.
+static size_t antialias(const Scene &scene, const RenderOptions &options, TraceFunction trace, int width, int height,
+                 double tan_half_fov, double deadline, std::vector<Vec3f> &framebuffer, CostMap &cost) {
+    // Objet vu par chaque pixel : un simple test d'intersection, bien moins coûteux que l'éclairage
+    const size_t pixel_count = static_cast<size_t>(height)*width;
+    std::vector<uint32_t> object_ids(pixel_count);
+    #pragma omp parallel for schedule(dynamic, 8)
+    for (int j = 0; j<height; j++) {
+        for (int i = 0; i<width; i++) {
+            Hit hit;
+            OORT_STAT(PrimaryRays);
+            bool found = scene_intersect(Vec3f(0,0,0), primary_ray_dir(i, j, width, height, tan_half_fov), scene, hit);
+            object_ids[static_cast<size_t>(j)*width + i] = found ? hit.object : NO_OBJECT;
+        }
+    }
+
+    // Contraste de chaque pixel avec ses voisins ; un changement d'objet passe avant toute différence de couleur
+    const float OBJECT_EDGE = 2.f;
+    std::vector<float> contrast(pixel_count, 0.f);
+    #pragma omp parallel for
+    for (int j = 0; j<height; j++) {
+        for (int i = 0; i<width; i++) {
+            const size_t p = static_cast<size_t>(j)*width + i;
+            const int neighbors[4][2] = {{i-1, j}, {i+1, j}, {i, j-1}, {i, j+1}};
+            for (const auto &n : neighbors) {
+                if (n[0] < 0 || n[0] >= width || n[1] < 0 || n[1] >= height) continue;
+                const size_t q = static_cast<size_t>(n[1])*width + n[0];
+                if (object_ids[p] != object_ids[q]) {
+                    contrast[p] = OBJECT_EDGE;
+                    break;
+                }
+                for (size_t c = 0; c<3; c++) {
+                    float a = std::max(0.f, std::min(1.f, framebuffer[p][c]));
+                    float b = std::max(0.f, std::min(1.f, framebuffer[q][c]));
+                    contrast[p] = std::max(contrast[p], std::abs(a - b));
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> pixels;
+    for (size_t p = 0; p < pixel_count; p++) {
+        if (contrast[p] > options.aa_threshold) pixels.push_back(p);
+    }
+    const size_t budget = static_cast<size_t>(options.aa_budget*pixel_count);
+    if (pixels.size() > budget) {
+        std::nth_element(pixels.begin(), pixels.begin() + budget, pixels.end(), [&](size_t a, size_t b) {
+            return contrast[a] > contrast[b];
+        });
+        pixels.resize(budget);
+    }
+
+    // Grille de n x n échantillons par pixel
+    int n = 1;
+    while ((n + 1)*(n + 1) <= options.aa_samples) n++;
+
+    // Les pixels retenus ne sont pas voisins en mémoire : on les distribue par petits paquets.
+    // Une fois le budget de temps dépassé, les pixels restants gardent leur couleur d'origine.
+    std::vector<Vec3f> refined(pixels.size());
+    std::vector<char> done(pixels.size(), 0);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (size_t k = 0; k < pixels.size(); k++) {
+        if (omp_get_wtime() >= deadline) continue;
+        const int i = static_cast<int>(pixels[k] % width), j = static_cast<int>(pixels[k] / width);
+        const double cost_start = cost.start();
+        Vec3f sum(0, 0, 0);
+        for (int sy = 0; sy < n; sy++) {
+            for (int sx = 0; sx < n; sx++) {
+                Vec3f dir = primary_ray_dir(i, j, width, height, tan_half_fov, (sx + 0.5)/n, (sy + 0.5)/n);
+                sum = sum + trace(Vec3f(0,0,0), dir, scene, options, nullptr, nullptr);
+            }
+        }
+        refined[k] = sum*(1.f/(n*n));
+        done[k] = 1;
+        cost.add(pixels[k], cost.since(cost_start));
+    }
+    // Les nouvelles couleurs ne sont écrites qu'à la fin : la détection a lu les couleurs d'origine
+    size_t count = 0;
+    for (size_t k = 0; k < pixels.size(); k++) {
+        if (done[k]) {
+            framebuffer[pixels[k]] = refined[k];
+            count++;
+        }
+    }
+    return count;
+}
+
+// Rend une passe d'une tuile dans framebuffer. La passe de pas step calcule les pixels dont les deux
+// coordonnées dans la tuile sont multiples de step, sauf ceux déjà calculés par la passe précédente
+// (multiples de 2*step), et recopie leur couleur sur le bloc step x step qu'ils représentent.
+// framebuffer commence à la ligne first_row de l'image (0 quand il la contient entière).
+// Avec lists, les rayons primaires ne testent que les objets de la liste de la tuile.
+static void render_tile(const Scene &scene, const RenderOptions &options, TraceFunction trace, const Tile &tile,
+                 int step, bool first_pass, int width, int height, double tan_half_fov, std::vector<Vec3f> &framebuffer,
+                 CostMap &cost, int first_row = 0, const TileObjectLists *lists = nullptr) {
+    for (int j = tile.y0; j<tile.y1; j += step) {
+        // Sur les lignes déjà échantillonnées, un pixel sur deux a été calculé par la passe précédente
+        const bool new_row = first_pass || (j - tile.y0) % (2*step) != 0;
+        const int i_begin = new_row ? tile.x0 : tile.x0 + step;
+        const int stride = new_row ? step : 2*step;
+
+        if (options.packets && stride == 1) {
+            // Les rayons primaires, cohérents, sont intersectés par paquets avec les noyaux vectoriels.
+            // Les rayons secondaires et d'ombre, incohérents, repartent ensuite un par un.
+            RayPacket packet;
+            for (int i0 = i_begin; i0<tile.x1; i0 += PACKET_SIZE) {
+                const double packet_start = cost.start();
+                packet_primary_rays(packet, i0, tile.x1, j, width, height, tan_half_fov);
+                if (lists != nullptr) lists->intersect_packet(scene, tile, packet);
+                else scene.intersect_packet(packet);
+                // Le coût de l'intersection du paquet est partagé entre ses rayons
+                const int lanes = std::min(PACKET_SIZE, tile.x1 - i0);
+                const float packet_cost = cost.since(packet_start)/lanes;
+                for (int k = 0; k < lanes; k++) {
+                    const double cost_start = cost.start();
+                    Vec3f dir(packet.dx[k], packet.dy[k], packet.dz[k]);
+                    Hit hit;
+                    hit.t = packet.object[k] == PACKET_NO_HIT ? std::numeric_limits<float>::max() : packet.t[k];
+                    hit.object = static_cast<uint32_t>(packet.object[k]);
+                    framebuffer[static_cast<size_t>(j-first_row)*width + i0+k] = trace(Vec3f(0,0,0), dir, scene, options, &hit, nullptr);
+                    cost.set(static_cast<size_t>(j)*width + i0+k, packet_cost + cost.since(cost_start));
+                }
+            }
+        } else {
+            for (int i = i_begin; i<tile.x1; i += stride) {
+                const double cost_start = cost.start();
+                Vec3f color;
+                if (lists != nullptr) {
+                    const Vec3f dir = primary_ray_dir(i, j, width, height, tan_half_fov);
+                    Hit hit;
+                    lists->intersect(scene, tile, Vec3f(0,0,0), dir, hit);
+                    color = trace(Vec3f(0,0,0), dir, scene, options, &hit, nullptr);
+                } else {
+                    color = cast_primary_ray(scene, options, trace, i, j, width, height, tan_half_fov);
+                }
+                const float pixel_cost = cost.since(cost_start);
+                for (int y = j; y < std::min(j + step, tile.y1); y++) {
+                    for (int x = i; x < std::min(i + step, tile.x1); x++) {
+                        framebuffer[static_cast<size_t>(y-first_row)*width + x] = color;
+                        cost.set(static_cast<size_t>(y)*width + x, pixel_cost);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void render_region(const Scene &scene, const RenderOptions &options, const Tile &tile,
+                   std::vector<Vec3f> &framebuffer) {
+    CostMap cost("", options.width, options.height);
+    framebuffer.resize(static_cast<size_t>(tile.y1 - tile.y0)*options.width);
+    render_tile(scene, options, select_trace(scene, options), tile, 1, true, options.width, options.height, tan(options.fov/2.),
+                framebuffer, cost, tile.y0);
+}
+
+void render_tiles(const Scene &scene, const RenderOptions &options, const std::vector<Tile> &tiles,
+                  std::vector<Vec3f> &framebuffer) {
+    const TraceFunction trace = select_trace(scene, options);
+    CostMap cost("", options.width, options.height);
+    TileObjectLists lists;
+    if (options.tile_lists) lists.build(scene, options.width, options.height, options.tile_size, tan(options.fov/2.));
+#ifdef OORT_STATS
+    const double start = omp_get_wtime();
+#endif
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t t = 0; t < tiles.size(); t++) {
+        render_tile(scene, options, trace, tiles[t], 1, true, options.width, options.height, tan(options.fov/2.),
+                    framebuffer, cost, 0, options.tile_lists ? &lists : nullptr);
+    }
+#ifdef OORT_STATS
+    stats_add_phase(Phase::Trace, omp_get_wtime() - start);
+#endif
+}
+
+// Rendu par bandes de tuiles (options.stream_window > 0) : seules stream_window bandes de tile_size lignes
+// sont en mémoire à la fois. Les tuiles d'une fenêtre sont distribuées aux threads, puis ses lignes sont
+// écrites dans le fichier avant de passer à la fenêtre suivante. Les fenêtres sont parcourues dans l'ordre
+// des lignes du fichier, de bas en haut en PFM. Chaque pixel est calculé par le même appel à render_tile,
+// sur la même grille de tuiles, qu'un rendu en mémoire en une passe : l'image est identique.
+static bool render_streaming(const Scene &scene, const RenderOptions &options, TraceFunction trace) {
+    const int width  = options.width;
+    const int height = options.height;
+    const int tile_size = std::max(1, options.tile_size);
+    const int window_rows = std::min(height, tile_size*options.stream_window);
+    const ImageFormat format = choose_image_format(options.output, options.format);
+    ImageStream stream(options.output, format, width, height);
+    if (!stream.is_ok()) return false;
+
+    std::vector<Vec3f> framebuffer(static_cast<size_t>(window_rows)*width);
+    CostMap cost("", width, height);
+    TileObjectLists lists;
+    if (options.tile_lists) lists.build(scene, width, height, tile_size, tan(options.fov/2.));
+    const int window_count = (height + window_rows - 1)/window_rows;
+    double trace_time = 0.;
+    for (int w = 0; w < window_count; w++) {
+        const int window = ImageStream::top_down(format) ? w : window_count - 1 - w;
+        const int y0 = window*window_rows, y1 = std::min(height, y0 + window_rows);
+        std::vector<Tile> tiles;
+        for (int y = y0; y < y1; y += tile_size) {
+            for (int x = 0; x < width; x += tile_size) {
+                tiles.push_back({x, y, std::min(width, x + tile_size), std::min(y1, y + tile_size)});
+            }
+        }
+        const double start = omp_get_wtime();
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t t = 0; t < tiles.size(); t++) {
+            render_tile(scene, options, trace, tiles[t], 1, true, width, height, tan(options.fov/2.), framebuffer, cost, y0,
+                        options.tile_lists ? &lists : nullptr);
+        }
+        trace_time += omp_get_wtime() - start;
+        if (!stream.write_rows(framebuffer.data(), y1 - y0)) return false;
+    }
+#ifdef OORT_STATS
+    stats_add_phase(Phase::Trace, trace_time);
+#endif
+    if (options.thread_report) {
+        std::cout << "Rendu par bandes : " << window_count << " fenêtres de " << window_rows << " lignes en "
+                  << trace_time << " s de calcul" << std::endl;
+    }
+    return stream.close();
+}
+
+// Empreinte des options qui changent la couleur des pixels : modèle et noyaux d'éclairage, tirage des
+// lumières, profondeur et seuil des rayons secondaires. Les paquets, la représentation compacte et les
+// listes par tuile donnent la même image et n'y entrent pas.
+static uint32_t shading_fingerprint(const RenderOptions &options) {
+    uint32_t min_weight;
+    std::memcpy(&min_weight, &options.min_weight, sizeof(min_weight));
+    const uint32_t values[5] = {static_cast<uint32_t>(options.shading), options.fast_shading,
+                                static_cast<uint32_t>(options.light_samples), static_cast<uint32_t>(options.max_depth), min_weight};
+    uint32_t hash = 2166136261u;
+    for (uint32_t value : values) hash = (hash ^ value)*16777619u;
+    return hash;
+}
+
+// Rendu à partir du G-buffer options.gbuffer. S'il n'existe pas encore ou a été écrit pour une autre image
+// ou une autre géométrie, la surface vue par le rayon primaire de chaque pixel est calculée et enregistrée ;
+// sinon elle est relue et les rayons primaires ne sont pas relancés. L'éclairage et les rayons secondaires
+// sont toujours recalculés : l'image est celle d'un rendu en une passe, suivie de l'anticrénelage demandé.
+static bool render_with_gbuffer(const Scene &scene, const RenderOptions &options, ImageWriter &writer, TraceFunction trace) {
+    const int width  = options.width;
+    const int height = options.height;
+    const double tan_half_fov = tan(options.fov/2.);
+    const double start = omp_get_wtime();
+
+    TileScheduler tiles(width, height, options.tile_size, options.tile_order);
+    GBuffer gbuffer(width, height, options.fov, static_cast<uint32_t>(scene.get_objects().size()), geometry_fingerprint(scene));
+    std::vector<GBufferSample> &samples = gbuffer.get_samples();
+    if (gbuffer.load(options.gbuffer)) {
+        std::cout << "G-buffer relu depuis " << options.gbuffer << " en " << omp_get_wtime() - start << " s" << std::endl;
+    } else {
+        // Mêmes calculs que pour le premier rayon dans trace
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t t = 0; t < tiles.size(); t++) {
+            const Tile &tile = tiles.get(t);
+            for (int j = tile.y0; j<tile.y1; j++) for (int i = tile.x0; i<tile.x1; i++) {
+                GBufferSample &sample = samples[static_cast<size_t>(j)*width + i];
+                sample = GBufferSample();
+                const Vec3f orig(0,0,0), dir = primary_ray_dir(i, j, width, height, tan_half_fov);
+                Hit hit;
+                if (!scene_intersect(orig, dir, scene, hit)) {
+                    sample.object = GBufferSample::NO_OBJECT;
+                    continue;
+                }
+                sample.object = hit.object;
+                sample.point = orig + dir*hit.t;
+                scene.get_objects()[hit.object]->get_surface(orig, dir, hit.t, sample.normal, sample.material);
+            }
+        }
+        if (gbuffer.save(options.gbuffer)) {
+            std::cout << "G-buffer écrit dans " << options.gbuffer << " (" << omp_get_wtime() - start << " s)" << std::endl;
+        } else {
+            std::cerr << "Erreur : impossible d'écrire le G-buffer " << options.gbuffer << std::endl;
+        }
+    }
+
+    // Les tuiles gardent la cohérence des rayons d'ombre et secondaires de pixels voisins
+    std::vector<Vec3f> framebuffer(static_cast<size_t>(height)*width);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t t = 0; t < tiles.size(); t++) {
+        const Tile &tile = tiles.get(t);
+        for (int j = tile.y0; j<tile.y1; j++) for (int i = tile.x0; i<tile.x1; i++) {
+            const size_t p = static_cast<size_t>(j)*width + i;
+            framebuffer[p] = trace(Vec3f(0,0,0), primary_ray_dir(i, j, width, height, tan_half_fov), scene, options,
+                                   nullptr, &samples[p]);
+        }
+    }
+    if (options.aa_samples > 1) {
+        CostMap cost("", width, height);
+        size_t count = antialias(scene, options, trace, width, height, tan_half_fov,
+                                 std::numeric_limits<double>::infinity(), framebuffer, cost);
+        std::cout << "Anticrénelage : " << count << " pixels suréchantillonnés ("
+                  << 100.*count/(static_cast<double>(width)*height) << " % de l'image)" << std::endl;
+    }
+    double elapsed = omp_get_wtime() - start;
+    if (options.thread_report) std::cout << "Rendu à partir du G-buffer en " << elapsed << " s" << std::endl;
+#ifdef OORT_STATS
+    stats_add_phase(Phase::Trace, elapsed);
+#endif
+    writer.submit(options.output, choose_image_format(options.output, options.format), width, height, std::move(framebuffer));
+    return true;
+}
+
+bool render(const Scene &scene, const RenderOptions &options, ImageWriter &writer) {
+    if (options.workers > 0) return render_distributed(scene, options, writer);
+    const TraceFunction trace = select_trace(scene, options);
+    if (options.stream_window > 0) return render_streaming(scene, options, trace);
+    if (!options.gbuffer.empty()) return render_with_gbuffer(scene, options, writer, trace);
+
+    const int width    = options.width;
+    const int height   = options.height;
+    const double fov   = options.fov;
+
+    TileScheduler tiles(width, height, options.tile_size, options.tile_order);
+    RenderProgress progress(width, height, fov, options.tile_size, options.tile_order, options.coarse_step, tiles.size(),
+                            shading_fingerprint(options), scene_fingerprint(scene));
+    if (!options.checkpoint.empty() && progress.load(options.checkpoint)) {
+        std::cout << "Reprise du rendu depuis " << options.checkpoint << " (passe " << progress.get_current_pass() + 1
+                  << "/" << progress.get_pass_count() << ")" << std::endl;
+    }
+    std::vector<Vec3f> &framebuffer = progress.get_framebuffer();
+    CostMap cost(options.heatmap, width, height);
+    TileObjectLists lists;
+    if (options.tile_lists) lists.build(scene, width, height, options.tile_size, tan(fov/2.));
+
+    // Les tuiles sont distribuées une par une aux threads qui se libèrent. Chaque thread mesure
+    // le temps passé à rendre ses tuiles pour vérifier l'équilibrage de la charge.
+    std::vector<double> busy_time(omp_get_max_threads(), 0.);
+    std::vector<size_t> tile_count(omp_get_max_threads(), 0);
+    const double start = omp_get_wtime();
+    double last_checkpoint = start;
+    bool out_of_time = false;
+
+    for (int pass = progress.get_current_pass(); pass < progress.get_pass_count() && !out_of_time; pass++) {
+        tiles.reset();
+        bool pass_done = false;
+        while (!pass_done && !out_of_time) {
+            // La passe avance par segments qui s'arrêtent au budget de temps ou à l'échéance du prochain point
+            // de reprise. Les threads finissent leur tuile en cours : à la fin du segment, l'image et l'état
+            // des tuiles sont cohérents et peuvent être écrits sur disque.
+            double deadline = std::numeric_limits<double>::infinity();
+            if (options.time_budget > 0.) deadline = start + options.time_budget;
+            if (!options.checkpoint.empty() && options.checkpoint_interval > 0.) {
+                deadline = std::min(deadline, last_checkpoint + options.checkpoint_interval);
+            }
+
+            #pragma omp parallel
+            {
+                const int thread = omp_get_thread_num();
+                size_t index;
+                while (omp_get_wtime() < deadline && tiles.next(index)) {
+                    if (progress.get_passes_done(index) > pass) continue; // tuile terminée avant la reprise
+                    double tile_start = omp_get_wtime();
+                    render_tile(scene, options, trace, tiles.get(index), progress.get_pass_step(pass),
+                                pass == 0, width, height, tan(fov/2.), framebuffer, cost, 0,
+                                options.tile_lists ? &lists : nullptr);
+                    progress.set_passes_done(index, pass + 1);
+                    busy_time[thread] += omp_get_wtime() - tile_start;
+                    tile_count[thread]++;
+                }
+            }
+
+            const double now = omp_get_wtime();
+            pass_done = progress.get_current_pass() > pass;
+            out_of_time = options.time_budget > 0. && now >= start + options.time_budget;
+            if (!options.checkpoint.empty() && !progress.is_complete()) {
+                if (!progress.save(options.checkpoint)) {
+                    std::cerr << "Erreur : impossible d'écrire le point de reprise " << options.checkpoint << std::endl;
+                }
+                last_checkpoint = now;
+            }
+        }
+    }
+    if (progress.is_complete() && options.aa_samples > 1 && !out_of_time) {
+        double deadline = options.time_budget > 0. ? start + options.time_budget : std::numeric_limits<double>::infinity();
+        size_t count = antialias(scene, options, trace, width, height, tan(fov/2.), deadline, framebuffer, cost);
+        std::cout << "Anticrénelage : " << count << " pixels suréchantillonnés ("
+                  << 100.*count/(static_cast<double>(width)*height) << " % de l'image)" << std::endl;
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    if (progress.is_complete()) {
+        // Le point de reprise d'un rendu terminé ne servirait plus
+        if (!options.checkpoint.empty()) std::remove(options.checkpoint.c_str());
+    } else {
+        std::cout << "Budget de temps atteint après " << elapsed << " s : passe " << progress.get_current_pass() + 1
+                  << "/" << progress.get_pass_count() << " en cours, image partielle écrite" << std::endl;
+    }
+
+    if (options.thread_report) {
+        std::cout << "Rendu : " << tiles.size() << " tuiles en " << elapsed << " s" << std::endl;
+        for (size_t thread = 0; thread < busy_time.size(); thread++) {
+            std::cout << "  thread " << thread << " : " << tile_count[thread] << " tuiles, occupé "
+                      << busy_time[thread] << " s (" << (elapsed > 0. ? 100.*busy_time[thread]/elapsed : 0.) << " %)" << std::endl;
+        }
+    }
+
+#ifdef OORT_STATS
+    stats_add_phase(Phase::Trace, elapsed);
+    if (cost.enabled()) {
+        if (options.output == "-") {
+            std::cerr << "La carte de coût n'est pas écrite quand l'image part sur la sortie standard" << std::endl;
+        } else {
+            std::string filename = heatmap_filename(options.output);
+            writer.submit(filename, choose_image_format(filename, ""), width, height, cost_heatmap(cost.get_cost()));
+        }
+    }
+#endif
+
+    // La conversion et l'écriture se font sur le thread de l'écrivain, pendant le rendu suivant
+    writer.submit(options.output, choose_image_format(options.output, options.format), width, height, std::move(framebuffer));
+    return true;
+}
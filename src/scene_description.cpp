@@ -0,0 +1,111 @@
+#include <vector>
+
+#include "scene_description.hpp"
+#include "sphere.hpp"
+#include "parallelepiped.hpp"
+#include "plane.hpp"
+#include "instance.hpp"
+#include "mesh.hpp"
+
+
+void collect_materials(const Object* object, std::vector<MaterialId>& materials) {
+    if (const CheckerboardPlane* plane = dynamic_cast<const CheckerboardPlane*>(object)) {
+        materials.push_back(plane->get_material1());
+        materials.push_back(plane->get_material2());
+    } else if (const Instance* instance = dynamic_cast<const Instance*>(object)) {
+        if (instance->overrides_material()) materials.push_back(instance->Object::get_material_id(Vec3f()));
+        else collect_materials(instance->get_prototype(), materials);
+    } else if (const Group* group = dynamic_cast<const Group*>(object)) {
+        for (const Object* child : group->get_children()) collect_materials(child, materials);
+    } else {
+        materials.push_back(object->get_material_id(object->get_position()));
+    }
+}
+
+void describe_object(const Object* object, std::vector<float>& out) {
+    auto push = [&out](const Vec3f& v) { out.insert(out.end(), {v.x, v.y, v.z}); };
+    if (const Sphere* sphere = dynamic_cast<const Sphere*>(object)) {
+        out.push_back(1);
+        push(sphere->get_position());
+        out.push_back(sphere->get_radius());
+    } else if (const Parallelepiped* box = dynamic_cast<const Parallelepiped*>(object)) {
+        out.push_back(2);
+        push(box->get_position());
+        push(box->get_size());
+        push(box->get_direction_x());
+        push(box->get_direction_y());
+        push(box->get_direction_z());
+    } else if (const Plane* plane = dynamic_cast<const Plane*>(object)) {
+        out.push_back(3);
+        push(plane->get_plane_normal());
+        out.push_back(plane->get_distance());
+    } else if (const Instance* instance = dynamic_cast<const Instance*>(object)) {
+        const Transform& transform = instance->get_transform();
+        out.push_back(4);
+        push(transform.apply_point(Vec3f(0, 0, 0)));
+        push(transform.apply_vector(Vec3f(1, 0, 0)));
+        push(transform.apply_vector(Vec3f(0, 1, 0)));
+        push(transform.apply_vector(Vec3f(0, 0, 1)));
+        out.push_back(instance->overrides_material());
+        describe_object(instance->get_prototype(), out);
+    } else if (const Group* group = dynamic_cast<const Group*>(object)) {
+        out.push_back(5);
+        out.push_back(group->get_children().size());
+        for (const Object* child : group->get_children()) describe_object(child, out);
+    } else {
+        const AABB bounds = object->get_bounds();
+        out.push_back(0);
+        push(object->get_position());
+        push(bounds.get_min());
+        push(bounds.get_max());
+        if (const TriangleMesh* mesh = dynamic_cast<const TriangleMesh*>(object)) {
+            // Empreinte du contenu en deux moitiés de 16 bits, représentées exactement par des flottants
+            const uint32_t hash = mesh->content_hash();
+            out.push_back(mesh->triangle_count());
+            out.push_back(mesh->vertex_count());
+            out.push_back(hash >> 16);
+            out.push_back(hash & 0xffff);
+        }
+    }
+    std::vector<MaterialId> materials;
+    collect_materials(object, materials);
+    out.insert(out.end(), materials.begin(), materials.end());
+}
+
+// Ajoute les octets à une empreinte FNV-1a
+static void hash_bytes(uint32_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t k = 0; k < size; k++) hash = (hash ^ bytes[k])*16777619u;
+}
+
+uint32_t geometry_fingerprint(const Scene& scene) {
+    uint32_t hash = 2166136261u;
+    std::vector<float> description;
+    for (const Object* object : scene.get_objects()) {
+        // La longueur sépare les descriptions de deux objets successifs
+        description.clear();
+        describe_object(object, description);
+        const uint32_t length = static_cast<uint32_t>(description.size());
+        hash_bytes(hash, &length, sizeof(length));
+        hash_bytes(hash, description.data(), description.size()*sizeof(float));
+    }
+    return hash;
+}
+
+uint32_t scene_fingerprint(const Scene& scene) {
+    uint32_t hash = geometry_fingerprint(scene);
+    const MaterialLibrary& materials = scene.get_materials();
+    for (size_t id = 0; id < materials.size(); id++) {
+        const Material& material = materials.get(static_cast<MaterialId>(id));
+        const Vec3f color = material.get_diffuse_color();
+        const Vec4f albedo = material.get_albedo();
+        const float values[9] = {color.x, color.y, color.z, albedo[0], albedo[1], albedo[2], albedo[3],
+                                 material.get_specular_exponent(), material.get_refractive_index()};
+        hash_bytes(hash, values, sizeof(values));
+    }
+    for (const Light& light : scene.get_lights()) {
+        const float values[5] = {light.position.x, light.position.y, light.position.z, light.intensity, light.radius};
+        hash_bytes(hash, values, sizeof(values));
+    }
+    return hash;
+}
@@ -0,0 +1,775 @@
+#include <charconv>
+#include <string_view>
+#include <unordered_map>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <chrono>
+#include <filesystem>
+
+#include "scene_io.hpp"
+#include "mapped_file.hpp"
+#include "stats.hpp"
+#include "sphere.hpp"
+#include "parallelepiped.hpp"
+#include "instance.hpp"
+#include "mesh.hpp"
+#include "light.hpp"
+
+
+void add_default_materials(MaterialLibrary& materials) {
+    materials.add("ivory",      Material(Vec3f(0.4, 0.4, 0.3), Vec4f(0.9,  0.5, 0.1, 0.0), 50., 1.));
+    materials.add("red_rubber", Material(Vec3f(0.3, 0.1, 0.1), Vec4f(1.4,  0.3, 0.0, 0.0), 10., 1.));
+    materials.add("mirror",     Material(Vec3f(1.0, 1.0, 1.0), Vec4f(0.0, 16.0, 0.8, 0.0), 1425., 1.));
+    materials.add("glass",      Material(Vec3f(0.6, 0.7, 0.8), Vec4f(0.0,  0.9, 0.1, 0.8), 125., 1.5));
+    materials.add("blue_metal", Material(Vec3f(0.05, 0.05, 0.25), Vec4f(0.7, 11.0, 0.6, 0.0), 1000., 1.));
+    materials.add("grey_metal", Material(Vec3f(0.25, 0.25, 0.25), Vec4f(0.7, 11.0, 0.6, 0.0), 1000., 1.));
+}
+
+
+// ---------------------------------------------------------------------------------------------------------
+// Fichier de configuration texte
+//
+// Le fichier est projeté en mémoire et analysé sur place : chaque champ est une vue sur le texte du fichier,
+// les nombres sont lus avec std::from_chars et les noms de matériaux déjà rencontrés sont retrouvés
+// dans une table de hachage indexée par ces vues. Aucune allocation n'est faite par ligne.
+
+// Champs d'une ligne : type; centre; rayon; matériau; intensité; dimensions; angle_x; angle_y; angle_z; prototype
+static const size_t CSV_FIELDS = 10;
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static std::string_view trim_field(std::string_view field) {
+    while (!field.empty() && is_blank(field.front())) field.remove_prefix(1);
+    while (!field.empty() && is_blank(field.back())) field.remove_suffix(1);
+    return field;
+}
+
+// Lit un nombre comme std::stof : les blancs et le signe + initiaux sont ignorés, ainsi que le texte qui suit le nombre
+static bool parse_float(std::string_view field, float& value) {
+    const char* begin = field.data();
+    const char* end = begin + field.size();
+    while (begin < end && is_blank(*begin)) begin++;
+    if (begin < end && *begin == '+') begin++;
+    return std::from_chars(begin, end, value).ec == std::errc();
+}
+
+static bool parse_int(std::string_view field, int& value) {
+    field = trim_field(field);
+    return std::from_chars(field.data(), field.data() + field.size(), value).ec == std::errc();
+}
+
+// Lit un vecteur écrit (x, y, z)
+static bool parse_vec3(std::string_view field, Vec3f& v) {
+    float xyz[3];
+    for (size_t c = 0; c < 3; c++) {
+        size_t comma = field.find(',');
+        if ((comma == std::string_view::npos) != (c == 2)) return false;
+        std::string_view part = field.substr(0, comma);
+        while (!part.empty() && (is_blank(part.front()) || part.front() == '(')) part.remove_prefix(1);
+        if (!parse_float(part, xyz[c])) return false;
+        if (c < 2) field.remove_prefix(comma + 1);
+    }
+    v = Vec3f(xyz[0], xyz[1], xyz[2]);
+    return true;
+}
+
+// Découpe la ligne en au plus count champs séparés par ';' ; les champs manquants restent vides
+static void split_fields(std::string_view line, std::string_view* fields, size_t count) {
+    for (size_t f = 0; f < count && !line.empty(); f++) {
+        size_t separator = line.find(';');
+        fields[f] = line.substr(0, separator);
+        line.remove_prefix(separator == std::string_view::npos ? line.size() : separator + 1);
+    }
+}
+
+// Parcourt les lignes utiles du fichier (ni en-tête, ni vides, ni commentaires)
+template <typename Line>
+static void for_each_line(const MappedFile& file, Line&& process) {
+    const char* p = file.data();
+    const char* end = p + file.size();
+    size_t line_number = 0;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        std::string_view line(p, eol - p);
+        p = eol + (eol < end);
+        if (line_number++ == 0) continue; // skip header
+        if (line.empty() || line[0] == '#' || trim_field(line).empty()) continue;
+        process(line, line_number);
+    }
+}
+
+// Objets d'un prototype en cours de description, puis le prototype lui-même une fois instancié
+struct PrototypeEntry {
+    std::vector<Object*> children;
+    const Object* object = nullptr;
+};
+
+// Facteur d'échelle ou angle d'une instance : "None" ou un champ vide donnent la valeur par défaut
+static bool parse_optional_vec3(std::string_view field, const Vec3f& fallback, Vec3f& v) {
+    std::string_view value = trim_field(field);
+    if (value.empty() || value == "None") {
+        v = fallback;
+        return true;
+    }
+    return parse_vec3(value, v);
+}
+
+static bool parse_optional_float(std::string_view field, float fallback, float& value) {
+    std::string_view text = trim_field(field);
+    if (text.empty() || text == "None") {
+        value = fallback;
+        return true;
+    }
+    return parse_float(text, value);
+}
+
+bool load_csv(const std::string& filename, Scene& scene) {
+    MappedFile file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Erreur : impossible d'ouvrir " << filename << std::endl;
+        return false;
+    }
+    MaterialLibrary& materials = scene.get_materials();
+    std::unordered_map<std::string_view, MaterialId> material_ids;
+    std::unordered_map<std::string_view, PrototypeEntry> prototypes;
+
+    for_each_line(file, [&](std::string_view line, size_t line_number) {
+        std::string_view fields[CSV_FIELDS];
+        split_fields(line, fields, CSV_FIELDS);
+        std::string_view type = trim_field(fields[0]);
+        std::string_view prototype_name = trim_field(fields[9]);
+
+        Vec3f center;
+        if (!parse_vec3(fields[1], center)) {
+            std::cerr << filename << ", ligne " << line_number << " ignorée : centre invalide" << std::endl;
+            return;
+        }
+
+        MaterialId material = 0;
+        std::string_view name = trim_field(fields[3]);
+        const bool instance_material = type == "Instance" && !name.empty() && name != "None";
+        if (type == "Sphere" || type == "Parallelepiped" || type == "Mesh" || instance_material) {
+            auto it = material_ids.find(name);
+            if (it != material_ids.end()) {
+                material = it->second;
+            } else {
+                std::string material_str(name);
+                if (!materials.find(material_str, material)) {
+                    // Matériau inconnu : on l'enregistre noir pour les prochains objets qui l'utilisent
+                    std::cerr << "Matériau inconnu : " << material_str << std::endl;
+                    material = materials.add(material_str, Material(Vec3f(0,0,0), Vec4f(0,0,0,0), 0, 0));
+                }
+                material_ids.emplace(name, material);
+            }
+        }
+
+        // Un objet qui nomme un prototype en fait partie, dans le repère du prototype, au lieu d'être ajouté à la scène
+        Object* object = nullptr;
+        if (type == "Sphere") {
+            float radius;
+            if (!parse_float(fields[2], radius)) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : rayon invalide" << std::endl;
+                return;
+            }
+            object = new Sphere(center, radius, material);
+        } else if (type == "Parallelepiped") {
+            Vec3f size;
+            float angle_x, angle_y, angle_z;
+            if (!parse_vec3(fields[5], size) || !parse_float(fields[6], angle_x) ||
+                !parse_float(fields[7], angle_y) || !parse_float(fields[8], angle_z)) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : dimensions ou angles invalides" << std::endl;
+                return;
+            }
+            object = new Parallelepiped(center, size, material, angle_x, angle_y, angle_z);
+        } else if (type == "Mesh") {
+            // Le champ du rayon donne le fichier OBJ, relatif au dossier du fichier de configuration
+            std::string path(trim_field(fields[2]));
+            size_t slash = filename.find_last_of('/');
+            if (!path.empty() && path[0] != '/' && slash != std::string::npos) path = filename.substr(0, slash + 1) + path;
+            object = load_obj(path, material);
+            if (object == nullptr) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : maillage illisible" << std::endl;
+                return;
+            }
+            object->set_position(center);
+        } else if (type == "Instance") {
+            Vec3f scale;
+            float angle_x, angle_y, angle_z;
+            if (!parse_optional_vec3(fields[5], Vec3f(1, 1, 1), scale) || !parse_optional_float(fields[6], 0.f, angle_x) ||
+                !parse_optional_float(fields[7], 0.f, angle_y) || !parse_optional_float(fields[8], 0.f, angle_z) ||
+                scale.x == 0.f || scale.y == 0.f || scale.z == 0.f) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : échelle ou angles invalides" << std::endl;
+                return;
+            }
+            auto it = prototypes.find(prototype_name);
+            if (it == prototypes.end()) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : prototype inconnu" << std::endl;
+                return;
+            }
+            // Le prototype est figé à sa première instance ; un prototype d'un seul objet est gardé sans groupe
+            PrototypeEntry& prototype = it->second;
+            if (prototype.object == nullptr) {
+                Object* shared = prototype.children.size() == 1 ? prototype.children[0] : new Group(prototype.children);
+                prototype.object = scene.add_prototype(shared);
+                prototype.children.clear();
+            }
+            Transform transform = Transform::compose(center, scale, angle_x, angle_y, angle_z);
+            scene.add_object(instance_material ? new Instance(prototype.object, transform, material)
+                                               : new Instance(prototype.object, transform));
+        } else if (type == "Lights") {
+            // Le champ du rayon donne le rayon d'influence, infini s'il vaut None
+            float intensity, radius;
+            if (!parse_float(fields[4], intensity)) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : intensité invalide" << std::endl;
+                return;
+            }
+            if (!parse_optional_float(fields[2], std::numeric_limits<float>::infinity(), radius) || !(radius > 0.f)) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : rayon d'influence invalide" << std::endl;
+                return;
+            }
+            scene.add_light(Light(center, intensity, radius));
+        }
+        if (object == nullptr) return;
+
+        if (prototype_name.empty() || prototype_name == "None") {
+            scene.add_object(object);
+            return;
+        }
+        PrototypeEntry& prototype = prototypes[prototype_name];
+        if (prototype.object != nullptr) {
+            std::cerr << filename << ", ligne " << line_number << " ignorée : le prototype est déjà instancié" << std::endl;
+            delete object;
+            return;
+        }
+        prototype.children.push_back(object);
+    });
+
+    // Prototypes décrits mais jamais instanciés : leurs objets ne sont pas rendus
+    for (auto& entry : prototypes) {
+        if (entry.second.children.empty()) continue;
+        std::cerr << filename << " : prototype " << entry.first << " jamais instancié, ses "
+                  << entry.second.children.size() << " objet(s) sont ignorés" << std::endl;
+        for (Object* child : entry.second.children) delete child;
+    }
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------
+// Maillages OBJ
+//
+// Seuls les sommets (v), les normales (vn) et les faces (f) sont lus ; les faces de plus de trois sommets
+// sont découpées en éventail. Les coordonnées de texture, groupes et matériaux du fichier sont ignorés.
+
+// Découpe le début de la ligne jusqu'au prochain blanc
+static std::string_view next_token(std::string_view& line) {
+    while (!line.empty() && is_blank(line.front())) line.remove_prefix(1);
+    size_t end = 0;
+    while (end < line.size() && !is_blank(line[end])) end++;
+    std::string_view token = line.substr(0, end);
+    line.remove_prefix(end);
+    return token;
+}
+
+static bool parse_obj_vec3(std::string_view line, Vec3f& v) {
+    float xyz[3];
+    for (size_t c = 0; c < 3; c++) {
+        if (!parse_float(next_token(line), xyz[c])) return false;
+    }
+    v = Vec3f(xyz[0], xyz[1], xyz[2]);
+    return true;
+}
+
+// Indice OBJ (à partir de 1, ou négatif depuis la fin) converti en indice à partir de 0. Faux s'il est hors du tableau.
+static bool parse_obj_index(std::string_view field, size_t count, uint32_t& index) {
+    long value;
+    if (field.empty() || std::from_chars(field.data(), field.data() + field.size(), value).ec != std::errc()) return false;
+    if (value < 0) value += static_cast<long>(count) + 1;
+    if (value < 1 || static_cast<size_t>(value) > count) return false;
+    index = static_cast<uint32_t>(value - 1);
+    return true;
+}
+
+TriangleMesh* load_obj(const std::string& filename, MaterialId material) {
+    const auto start = std::chrono::steady_clock::now();
+    MappedFile file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Erreur : impossible d'ouvrir " << filename << std::endl;
+        return nullptr;
+    }
+    std::vector<Vec3f> vertices, normals;
+    std::vector<uint32_t> triangles, normal_indices;
+    bool has_normals = false;
+    std::vector<uint32_t> face, face_normals;
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+    size_t line_number = 0;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        std::string_view line(p, eol - p);
+        p = eol + (eol < end);
+        line_number++;
+        std::string_view keyword = next_token(line);
+
+        if (keyword == "v" || keyword == "vn") {
+            Vec3f v;
+            if (!parse_obj_vec3(line, v)) {
+                std::cerr << "Erreur : " << filename << ", ligne " << line_number << " : coordonnées invalides" << std::endl;
+                return nullptr;
+            }
+            (keyword == "v" ? vertices : normals).push_back(v);
+        } else if (keyword == "f") {
+            // Chaque sommet s'écrit v, v/vt, v//vn ou v/vt/vn
+            face.clear();
+            face_normals.clear();
+            for (std::string_view corner = next_token(line); !corner.empty(); corner = next_token(line)) {
+                size_t slash = corner.find('/');
+                uint32_t vertex, normal = TriangleMesh::NO_NORMAL;
+                if (!parse_obj_index(corner.substr(0, slash), vertices.size(), vertex)) {
+                    std::cerr << "Erreur : " << filename << ", ligne " << line_number << " : sommet invalide" << std::endl;
+                    return nullptr;
+                }
+                size_t second = slash == std::string_view::npos ? slash : corner.find('/', slash + 1);
+                if (second != std::string_view::npos) {
+                    if (!parse_obj_index(corner.substr(second + 1), normals.size(), normal)) {
+                        std::cerr << "Erreur : " << filename << ", ligne " << line_number << " : normale invalide" << std::endl;
+                        return nullptr;
+                    }
+                    has_normals = true;
+                }
+                face.push_back(vertex);
+                face_normals.push_back(normal);
+            }
+            for (size_t k = 2; k < face.size(); k++) {
+                const size_t corners[3] = {0, k - 1, k};
+                for (size_t c : corners) {
+                    triangles.push_back(face[c]);
+                    normal_indices.push_back(face_normals[c]);
+                }
+            }
+        }
+    }
+    if (triangles.empty()) {
+        std::cerr << "Erreur : " << filename << " ne contient aucun triangle" << std::endl;
+        return nullptr;
+    }
+    if (!has_normals) normal_indices.clear();
+
+    const auto parsed = std::chrono::steady_clock::now();
+    TriangleMesh* mesh = new TriangleMesh(std::move(vertices), std::move(triangles), std::move(normals),
+                                          std::move(normal_indices), material);
+    mesh->set_source(filename);
+    const auto built = std::chrono::steady_clock::now();
+    std::cout << filename << " : " << mesh->triangle_count() << " triangles, " << mesh->vertex_count() << " sommets lus en "
+              << std::chrono::duration<double>(parsed - start).count() << " s, BVH construite en "
+              << std::chrono::duration<double>(built - parsed).count() << " s, "
+              << double(mesh->memory_usage()) / mesh->triangle_count() << " octets par triangle" << std::endl;
+    return mesh;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------
+// Format binaire
+//
+// En-tête, table des matériaux puis table des enregistrements, tous de taille fixe : les prototypes, chacun
+// suivi de ses parties, puis les objets de la scène dans leur ordre et enfin les lumières. Les tables sont
+// lues sur place dans le fichier projeté en mémoire ; les parallélépipèdes sont stockés avec leurs axes déjà
+// calculés et les instances avec leur transformation. Les maillages ne gardent que le chemin de leur fichier
+// OBJ, relu au chargement, dans une table de chemins placée après les enregistrements. Les nombres sont écrits
+// dans l'ordre des octets de la machine. Une scène dont un objet n'a pas d'enregistrement n'est pas convertie.
+
+static const char SCENE_MAGIC[8] = {'O', 'O', 'R', 'T', 'S', 'C', 'N', '1'};
+static const uint32_t SCENE_VERSION = 3;
+
+struct SceneFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t material_count;
+    uint64_t record_count;
+    uint64_t material_offset;
+    uint64_t record_offset;
+    uint64_t path_offset;
+    uint64_t path_size;
+};
+
+static const size_t MATERIAL_NAME_SIZE = 32;
+
+struct SceneFileMaterial {
+    char name[MATERIAL_NAME_SIZE]; // terminé par un zéro
+    float diffuse_color[3];
+    float albedo[4];
+    float specular_exponent;
+    float refractive_index;
+};
+
+enum SceneRecordType : uint16_t {
+    RECORD_SPHERE = 1,
+    RECORD_PARALLELEPIPED = 2,
+    RECORD_LIGHT = 3,
+    RECORD_PROTOTYPE = 4,
+    RECORD_INSTANCE = 5,
+    RECORD_MESH = 6
+};
+
+// data contient le rayon d'une sphère, les dimensions puis les axes x, y et z d'un parallélépipède,
+// ou l'intensité d'une lumière et son rayon d'influence (0 pour un rayon infini). Un prototype a dans
+// index[0] le nombre de ses parties, sphères, parallélépipèdes ou maillages, dont les enregistrements le
+// suivent. Un maillage a dans index[0] et index[1] le début et la longueur du chemin de son fichier OBJ
+// dans la table des chemins, relatif au dossier de la scène binaire s'il est dans ce dossier, absolu sinon.
+// Une instance a sa translation dans position, la partie linéaire de sa transformation (par lignes) dans
+// data[0..8], le numéro de son prototype dans index[9] et 1 dans index[10] si material remplace les
+// matériaux du prototype.
+struct SceneFileRecord {
+    uint16_t type;
+    uint16_t material;
+    float position[3];
+    union {
+        float data[12];
+        uint32_t index[12];
+    };
+};
+static_assert(sizeof(SceneFileRecord) == 64, "enregistrement de taille inattendue");
+
+static void store(const Vec3f& v, float* out) {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+// Enregistrement d'une sphère, d'un parallélépipède ou d'un maillage lu dans un fichier OBJ, dont le chemin
+// est ajouté à paths (relatif au dossier directory si possible). Faux pour les autres objets.
+static bool store_primitive(const Object* object, const std::filesystem::path& directory, std::string& paths,
+                            SceneFileRecord& record) {
+    std::memset(&record, 0, sizeof(record));
+    store(object->get_position(), record.position);
+    record.material = object->get_material_id(object->get_position());
+    if (const Sphere* sphere = dynamic_cast<const Sphere*>(object)) {
+        record.type = RECORD_SPHERE;
+        record.data[0] = sphere->get_radius();
+    } else if (const Parallelepiped* box = dynamic_cast<const Parallelepiped*>(object)) {
+        record.type = RECORD_PARALLELEPIPED;
+        store(box->get_size(), record.data);
+        store(box->get_direction_x(), record.data + 3);
+        store(box->get_direction_y(), record.data + 6);
+        store(box->get_direction_z(), record.data + 9);
+    } else if (const TriangleMesh* mesh = dynamic_cast<const TriangleMesh*>(object)) {
+        if (mesh->get_source().empty()) return false;
+        const std::filesystem::path source = std::filesystem::absolute(mesh->get_source()).lexically_normal();
+        const std::filesystem::path relative = source.lexically_relative(directory);
+        const bool inside = !relative.empty() && *relative.begin() != "..";
+        const std::string path = inside ? relative.generic_string() : source.string();
+        record.type = RECORD_MESH;
+        record.index[0] = static_cast<uint32_t>(paths.size());
+        record.index[1] = static_cast<uint32_t>(path.size());
+        paths += path;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool save_scene_binary(const std::string& filename, const Scene& scene) {
+    const MaterialLibrary& materials = scene.get_materials();
+    std::vector<SceneFileMaterial> material_table(materials.size());
+    for (size_t id = 0; id < materials.size(); id++) {
+        SceneFileMaterial& entry = material_table[id];
+        std::memset(&entry, 0, sizeof(entry));
+        const std::string& name = materials.get_name(static_cast<MaterialId>(id));
+        if (name.size() >= MATERIAL_NAME_SIZE) {
+            std::cerr << "Erreur : nom de matériau trop long pour le format binaire : " << name << std::endl;
+            return false;
+        }
+        std::memcpy(entry.name, name.data(), name.size());
+        const Material& material = materials.get(static_cast<MaterialId>(id));
+        store(material.get_diffuse_color(), entry.diffuse_color);
+        Vec4f albedo = material.get_albedo();
+        for (size_t c = 0; c < 4; c++) entry.albedo[c] = albedo[c];
+        entry.specular_exponent = material.get_specular_exponent();
+        entry.refractive_index = material.get_refractive_index();
+    }
+
+    std::vector<SceneFileRecord> records;
+    records.reserve(scene.get_objects().size() + scene.get_lights().size());
+    const std::filesystem::path parent = std::filesystem::path(filename).parent_path();
+    const std::filesystem::path directory = (parent.empty() ? std::filesystem::current_path() : std::filesystem::absolute(parent)).lexically_normal();
+    std::string paths;
+    size_t unsupported = 0;
+    // Un prototype d'un seul objet est gardé sans groupe, comme à la lecture d'un fichier de configuration
+    std::unordered_map<const Object*, uint32_t> prototype_ids;
+    for (const Object* prototype : scene.get_prototypes()) {
+        std::vector<const Object*> parts;
+        if (const Group* group = dynamic_cast<const Group*>(prototype)) {
+            parts.assign(group->get_children().begin(), group->get_children().end());
+        } else {
+            parts.push_back(prototype);
+        }
+        SceneFileRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.type = RECORD_PROTOTYPE;
+        record.index[0] = static_cast<uint32_t>(parts.size());
+        records.push_back(record);
+        for (const Object* part : parts) {
+            if (store_primitive(part, directory, paths, record)) records.push_back(record);
+            else unsupported++;
+        }
+        prototype_ids.emplace(prototype, static_cast<uint32_t>(prototype_ids.size()));
+    }
+    for (const Object* object : scene.get_objects()) {
+        SceneFileRecord record;
+        if (const Instance* instance = dynamic_cast<const Instance*>(object)) {
+            auto it = prototype_ids.find(instance->get_prototype());
+            if (it == prototype_ids.end()) {
+                unsupported++;
+                continue;
+            }
+            std::memset(&record, 0, sizeof(record));
+            record.type = RECORD_INSTANCE;
+            float matrix[12];
+            instance->get_transform().get_matrix(matrix);
+            for (size_t i = 0; i < 3; i++) {
+                record.position[i] = matrix[4*i + 3];
+                for (size_t j = 0; j < 3; j++) record.data[3*i + j] = matrix[4*i + j];
+            }
+            record.index[9] = it->second;
+            record.index[10] = instance->overrides_material();
+            if (instance->overrides_material()) record.material = instance->Object::get_material_id(Vec3f());
+        } else if (!store_primitive(object, directory, paths, record)) {
+            unsupported++;
+            continue;
+        }
+        records.push_back(record);
+    }
+    for (const Light& light : scene.get_lights()) {
+        SceneFileRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.type = RECORD_LIGHT;
+        store(light.position, record.position);
+        record.data[0] = light.intensity;
+        record.data[1] = light.is_bounded() ? light.radius : 0.f;
+        records.push_back(record);
+    }
+    if (unsupported > 0) {
+        std::cerr << "Erreur : " << unsupported << " objet(s) d'un type non pris en charge par le format binaire, "
+                  << filename << " n'est pas écrit" << std::endl;
+        return false;
+    }
+
+    SceneFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+    header.version = SCENE_VERSION;
+    header.material_count = static_cast<uint32_t>(material_table.size());
+    header.record_count = records.size();
+    header.material_offset = sizeof(SceneFileHeader);
+    // Les enregistrements commencent sur un multiple de 64 octets
+    header.record_offset = (header.material_offset + material_table.size()*sizeof(SceneFileMaterial) + 63) / 64 * 64;
+    header.path_offset = header.record_offset + records.size()*sizeof(SceneFileRecord);
+    header.path_size = paths.size();
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Erreur : impossible d'écrire " << filename << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(material_table.data()), material_table.size()*sizeof(SceneFileMaterial));
+    const std::vector<char> padding(header.record_offset - header.material_offset - material_table.size()*sizeof(SceneFileMaterial), 0);
+    file.write(padding.data(), padding.size());
+    file.write(reinterpret_cast<const char*>(records.data()), records.size()*sizeof(SceneFileRecord));
+    file.write(paths.data(), paths.size());
+    file.close();
+    if (!file) {
+        std::cerr << "Erreur : impossible d'écrire " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_scene_binary(const std::string& filename, Scene& scene) {
+    MappedFile file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Erreur : impossible d'ouvrir " << filename << std::endl;
+        return false;
+    }
+    SceneFileHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Erreur : " << filename << " n'est pas une scène binaire" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    // Chaque table doit commencer dans le fichier et y tenir ; les comptes sont comparés à la place qui reste
+    // pour qu'aucun calcul ne déborde
+    if (std::memcmp(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 || header.version != SCENE_VERSION ||
+        header.material_offset > file.size() ||
+        header.material_count > (file.size() - header.material_offset) / sizeof(SceneFileMaterial) ||
+        header.record_offset > file.size() || header.record_offset % alignof(SceneFileRecord) != 0 ||
+        header.record_count > (file.size() - header.record_offset) / sizeof(SceneFileRecord) ||
+        header.path_offset > file.size() || header.path_size > file.size() - header.path_offset) {
+        std::cerr << "Erreur : " << filename << " n'est pas une scène binaire valide" << std::endl;
+        return false;
+    }
+
+    // Les matériaux sont retrouvés par leur nom dans la bibliothèque de la scène, comme pour un fichier
+    // de configuration ; ceux qu'elle ne connaît pas sont ajoutés avec les propriétés enregistrées.
+    MaterialLibrary& materials = scene.get_materials();
+    std::vector<MaterialId> material_ids(header.material_count);
+    for (size_t id = 0; id < header.material_count; id++) {
+        SceneFileMaterial entry;
+        std::memcpy(&entry, file.data() + header.material_offset + id*sizeof(SceneFileMaterial), sizeof(entry));
+        entry.name[MATERIAL_NAME_SIZE - 1] = '\0';
+        std::string name(entry.name);
+        if (!materials.find(name, material_ids[id])) {
+            material_ids[id] = materials.add(name, Material(Vec3f(entry.diffuse_color[0], entry.diffuse_color[1], entry.diffuse_color[2]),
+                                                            Vec4f(entry.albedo[0], entry.albedo[1], entry.albedo[2], entry.albedo[3]),
+                                                            entry.specular_exponent, entry.refractive_index));
+        }
+    }
+
+    const SceneFileRecord* records = reinterpret_cast<const SceneFileRecord*>(file.data() + header.record_offset);
+    // Sphère, parallélépipède ou maillage de l'enregistrement ; nullptr pour les autres types et pour un
+    // maillage illisible. Un chemin relatif l'est au dossier de la scène binaire.
+    const char* paths = reinterpret_cast<const char*>(file.data() + header.path_offset);
+    auto make_primitive = [&](const SceneFileRecord& record) -> Object* {
+        const float* d = record.data;
+        const Vec3f position(record.position[0], record.position[1], record.position[2]);
+        const MaterialId material = material_ids[record.material];
+        if (record.type == RECORD_SPHERE) return new Sphere(position, d[0], material);
+        if (record.type == RECORD_PARALLELEPIPED) {
+            return new Parallelepiped(position, Vec3f(d[0], d[1], d[2]), material,
+                                      Vec3f(d[3], d[4], d[5]), Vec3f(d[6], d[7], d[8]), Vec3f(d[9], d[10], d[11]));
+        }
+        if (record.type != RECORD_MESH || record.index[0] > header.path_size ||
+            record.index[1] > header.path_size - record.index[0]) return nullptr;
+        std::string path(paths + record.index[0], record.index[1]);
+        size_t slash = filename.find_last_of('/');
+        if (!path.empty() && path[0] != '/' && slash != std::string::npos) path = filename.substr(0, slash + 1) + path;
+        TriangleMesh* mesh = load_obj(path, material);
+        if (mesh != nullptr) mesh->set_position(position);
+        return mesh;
+    };
+    std::vector<const Object*> prototypes;
+    for (size_t k = 0; k < header.record_count; k++) {
+        const SceneFileRecord& record = records[k];
+        const float* d = record.data;
+        Vec3f position(record.position[0], record.position[1], record.position[2]);
+        if (record.type == RECORD_LIGHT) {
+            scene.add_light(d[1] > 0.f ? Light(position, d[0], d[1]) : Light(position, d[0]));
+            continue;
+        }
+        if (record.type == RECORD_PROTOTYPE) {
+            const size_t count = record.index[0];
+            std::vector<Object*> parts;
+            for (size_t part = k + 1; part <= k + count && part < header.record_count; part++) {
+                Object* object = records[part].material < material_ids.size() ? make_primitive(records[part]) : nullptr;
+                if (object == nullptr) break;
+                parts.push_back(object);
+            }
+            if (count == 0 || parts.size() != count) {
+                for (Object* object : parts) delete object;
+                std::cerr << "Erreur : " << filename << " : prototype invalide à l'enregistrement " << k << std::endl;
+                return false;
+            }
+            prototypes.push_back(scene.add_prototype(count == 1 ? parts[0] : new Group(parts)));
+            k += count;
+            continue;
+        }
+        const bool uses_material = record.type != RECORD_INSTANCE || record.index[10] != 0;
+        if (uses_material && record.material >= material_ids.size()) {
+            std::cerr << "Erreur : " << filename << " : matériau invalide pour l'objet " << k << std::endl;
+            return false;
+        }
+        if (record.type == RECORD_INSTANCE) {
+            if (record.index[9] >= prototypes.size()) {
+                std::cerr << "Erreur : " << filename << " : prototype inconnu pour l'objet " << k << std::endl;
+                return false;
+            }
+            float matrix[12];
+            for (size_t i = 0; i < 3; i++) {
+                for (size_t j = 0; j < 3; j++) matrix[4*i + j] = d[3*i + j];
+                matrix[4*i + 3] = record.position[i];
+            }
+            const Object* prototype = prototypes[record.index[9]];
+            scene.add_object(uses_material ? new Instance(prototype, Transform(matrix), material_ids[record.material])
+                                           : new Instance(prototype, Transform(matrix)));
+        } else if (Object* object = make_primitive(record)) {
+            scene.add_object(object);
+        } else if (record.type == RECORD_MESH) {
+            std::cerr << "Erreur : " << filename << " : maillage illisible pour l'objet " << k << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool load_scene(const std::string& filename, Scene& scene) {
+    OORT_PHASE_TIMER(Parse);
+    char magic[sizeof(SCENE_MAGIC)] = {0};
+    std::ifstream file(filename, std::ios::binary);
+    file.read(magic, sizeof(magic));
+    if (file && std::memcmp(magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) == 0) {
+        return load_scene_binary(filename, scene);
+    }
+    return load_csv(filename, scene);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------
+// Fichier d'animation
+
+// Champs d'une ligne : type; cible; numéro; image; position ou centre; tours
+static const size_t ANIMATION_FIELDS = 6;
+
+bool load_animation(const std::string& filename, Animation& animation) {
+    MappedFile file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Erreur : impossible d'ouvrir " << filename << std::endl;
+        return false;
+    }
+    for_each_line(file, [&](std::string_view line, size_t line_number) {
+        std::string_view fields[ANIMATION_FIELDS];
+        split_fields(line, fields, ANIMATION_FIELDS);
+        std::string_view type = trim_field(fields[0]);
+        std::string_view target_name = trim_field(fields[1]);
+
+        AnimationTarget target;
+        if (target_name == "Object") target = AnimationTarget::Object;
+        else if (target_name == "Lights") target = AnimationTarget::Light;
+        else {
+            std::cerr << filename << ", ligne " << line_number << " ignorée : cible inconnue" << std::endl;
+            return;
+        }
+        int index;
+        Vec3f position;
+        if (!parse_int(fields[2], index) || index < 0 || !parse_vec3(fields[4], position)) {
+            std::cerr << filename << ", ligne " << line_number << " ignorée : numéro ou position invalide" << std::endl;
+            return;
+        }
+
+        if (type == "Key") {
+            int frame;
+            if (!parse_int(fields[3], frame) || frame < 0) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : image invalide" << std::endl;
+                return;
+            }
+            animation.add_key(target, index, frame, position);
+        } else if (type == "Orbit") {
+            float turns;
+            if (!parse_float(fields[5], turns)) {
+                std::cerr << filename << ", ligne " << line_number << " ignorée : nombre de tours invalide" << std::endl;
+                return;
+            }
+            animation.add_orbit(target, index, position, turns);
+        } else {
+            std::cerr << filename << ", ligne " << line_number << " ignorée : type inconnu" << std::endl;
+        }
+    });
+    return true;
+}
@@ -0,0 +1,88 @@
+#include "stats.hpp"
+
+#ifdef OORT_STATS
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+// Noms des compteurs dans le fichier JSON, dans l'ordre de Stat
+static const char* const STAT_NAMES[STAT_COUNT] = {
+    "primary_rays", "reflection_rays", "refraction_rays", "shadow_rays",
+    "sphere_tests", "parallelepiped_tests", "plane_tests", "triangle_tests", "other_tests", "box_tests"
+};
+static const char* const PHASE_NAMES[PHASE_COUNT] = {"parse", "build", "trace", "output"};
+
+static void write_counters(std::ostream& out, const StatsCounters& counters) {
+    out << "{";
+    for (size_t i = 0; i < STAT_COUNT; i++) {
+        out << (i > 0 ? ", " : "") << "\"" << STAT_NAMES[i] << "\": " << counters.counters[i];
+    }
+    out << ", \"rays\": " << counters.rays() << "}";
+}
+
+bool write_stats_json(const std::string& filename) {
+    const StatsCounters total = stats_totals();
+    const std::vector<StatsCounters> threads = stats_per_thread();
+    double phases[PHASE_COUNT];
+    {
+        StatsRegistry& registry = stats_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::copy(registry.phases, registry.phases + PHASE_COUNT, phases);
+    }
+
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Erreur : impossible d'écrire les statistiques dans " << filename << std::endl;
+        return false;
+    }
+    out << std::setprecision(6);
+    out << "{\n  \"phases\": {";
+    for (size_t i = 0; i < PHASE_COUNT; i++) out << (i > 0 ? ", " : "") << "\"" << PHASE_NAMES[i] << "\": " << phases[i];
+    out << "},\n  \"counters\": ";
+    write_counters(out, total);
+    const double trace = phases[static_cast<size_t>(Phase::Trace)];
+    out << ",\n  \"rays_per_second\": " << (trace > 0. ? total.rays()/trace : 0.);
+
+    // Histogramme des profondeurs, sans les cases vides de la fin
+    size_t depth_count = STATS_DEPTH_BINS;
+    while (depth_count > 0 && total.depth[depth_count - 1] == 0) depth_count--;
+    out << ",\n  \"max_depth\": " << (depth_count > 0 ? depth_count - 1 : 0) << ",\n  \"depth_histogram\": [";
+    for (size_t d = 0; d < depth_count; d++) out << (d > 0 ? ", " : "") << total.depth[d];
+    out << "],\n  \"threads\": [";
+    for (size_t t = 0; t < threads.size(); t++) {
+        out << (t > 0 ? "," : "") << "\n    ";
+        write_counters(out, threads[t]);
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+std::string heatmap_filename(const std::string& output) {
+    size_t slash = output.find_last_of("/\\");
+    size_t dot = output.find_last_of('.');
+    std::string stem = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? output.substr(0, dot) : output;
+    return stem + "_cost.ppm";
+}
+
+std::vector<Vec3f> cost_heatmap(const std::vector<float>& cost) {
+    std::vector<Vec3f> image(cost.size(), Vec3f(0, 0, 0));
+    if (cost.empty()) return image;
+
+    // Quelques pixels très coûteux écraseraient l'échelle : le blanc correspond au 99e centile
+    std::vector<float> sorted(cost);
+    size_t rank = sorted.size()*99/100;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    const float scale = sorted[rank] > 0.f ? sorted[rank] : 1.f;
+
+    const Vec3f ramp[5] = {Vec3f(0, 0, 0), Vec3f(0, 0, 1), Vec3f(1, 0, 0), Vec3f(1, 1, 0), Vec3f(1, 1, 1)};
+    for (size_t p = 0; p < cost.size(); p++) {
+        float x = std::max(0.f, std::min(1.f, cost[p]/scale))*4.f;
+        int k = std::min(static_cast<int>(x), 3);
+        float f = x - k;
+        image[p] = ramp[k]*(1.f - f) + ramp[k + 1]*f;
+    }
+    return image;
+}
+
+#endif
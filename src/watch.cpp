@@ -0,0 +1,485 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <omp.h>
+
+#include "watch.hpp"
+#include "scene_description.hpp"
+#include "plane.hpp"
+#include "tiles.hpp"
+
+
+// Intervalle entre deux vérifications du fichier surveillé
+static const auto POLL_INTERVAL = std::chrono::milliseconds(200);
+// Marge ajoutée aux boîtes des objets modifiés : les rayons d'ombre partent d'un point décalé le long de la normale
+static const float BOUNDS_MARGIN = 1e-2f;
+// Profondeur minimale d'un point projeté à l'écran ; plus près de la caméra son image n'est plus bornée
+static const float NEAR_DEPTH = 1e-4f;
+
+// Enveloppe convexe de points et de directions (points à l'infini), dont l'image à l'écran est à recalculer.
+// Si bound n'est pas vide, la partie à recalculer est aussi dans l'enveloppe de ces points.
+struct Hull {
+    std::vector<Vec3f> points;
+    std::vector<Vec3f> directions;
+    std::vector<Vec3f> bound;
+};
+
+// Plan de normale unitaire : points p tels que normal*p = distance
+struct PlaneEquation {
+    Vec3f normal;
+    float distance;
+};
+
+// Surfaces qui peuvent recevoir une ombre : les objets bornés, dans bounds, et les plans. clippable est faux
+// si la scène a d'autres objets infinis.  Les plans, opaques, cachent ce qui est derrière eux : bounds est
+// limitée au côté de la caméra des plans perpendiculaires à un axe.
+struct Receivers {
+    AABB bounds;
+    std::vector<PlaneEquation> planes;
+    bool clippable = true;
+};
+
+static PlaneEquation plane_equation(const Plane* plane) {
+    Vec3f normal = plane->get_plane_normal();
+    const float length = normal.norm();
+    return {normal*(1.f/length), plane->get_distance()*length};
+}
+
+static void corners(const AABB& box, std::vector<Vec3f>& points) {
+    const Vec3f lo = box.get_min(), hi = box.get_max();
+    for (int k = 0; k < 8; k++) points.push_back(Vec3f(k & 1 ? hi.x : lo.x, k & 2 ? hi.y : lo.y, k & 4 ? hi.z : lo.z));
+}
+
+static bool same_lights(const std::vector<Light>& a, const std::vector<Light>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].position.x != b[i].position.x || a[i].position.y != b[i].position.y || a[i].position.z != b[i].position.z ||
+            a[i].intensity != b[i].intensity || a[i].radius != b[i].radius) return false;
+    }
+    return true;
+}
+
+// Vrai si les matériaux communs aux deux bibliothèques sont identiques : un même indice désigne alors le même matériau
+static bool same_materials(const MaterialLibrary& a, const MaterialLibrary& b) {
+    for (size_t id = 0; id < std::min(a.size(), b.size()); id++) {
+        const Material& ma = a.get(static_cast<MaterialId>(id));
+        const Material& mb = b.get(static_cast<MaterialId>(id));
+        const Vec3f ca = ma.get_diffuse_color(), cb = mb.get_diffuse_color();
+        const Vec4f aa = ma.get_albedo(), ab = mb.get_albedo();
+        if (ca.x != cb.x || ca.y != cb.y || ca.z != cb.z || aa[0] != ab[0] || aa[1] != ab[1] || aa[2] != ab[2] ||
+            aa[3] != ab[3] || ma.get_specular_exponent() != mb.get_specular_exponent() ||
+            ma.get_refractive_index() != mb.get_refractive_index()) return false;
+    }
+    return true;
+}
+
+// Partie du volume d'ombre de la boîte (points L + t (c - L), t >= 1, c dans la boîte) à moins de reach de
+// la lumière L : elle est dans l'union des copies de la boîte agrandies depuis L d'un facteur de 1 à
+// reach / distance de L à la boîte. Faux si la boîte est hors de portée ; L doit être hors de la boîte.
+static bool truncated_shadow(const AABB& box, const Vec3f& L, float reach, Hull& hull) {
+    const Vec3f lo = box.get_min(), hi = box.get_max();
+    Vec3f to_box = Vec3f(std::min(std::max(L.x, lo.x), hi.x), std::min(std::max(L.y, lo.y), hi.y),
+                         std::min(std::max(L.z, lo.z), hi.z)) - L;
+    const float distance = to_box.norm();
+    if (distance >= reach) return false;
+    const float scale = reach / distance;
+    corners(box, hull.points);
+    for (size_t k = 0; k < 8; k++) hull.points.push_back(L + (hull.points[k] - L)*scale);
+    return true;
+}
+
+// Volume d'ombre de la boîte pour la lumière, limité à la sphère d'influence d'une lumière bornée.
+// Faux si la lumière n'atteint pas la boîte.
+static bool shadow_hull(const AABB& box, const Light& light, Hull& hull) {
+    const Vec3f L = light.position;
+    if (box.contains(L)) {
+        // L'ombre part dans toutes les directions
+        hull.directions = {Vec3f(1, 0, 0), Vec3f(-1, 0, 0), Vec3f(0, 1, 0), Vec3f(0, -1, 0), Vec3f(0, 0, 1), Vec3f(0, 0, -1)};
+        return true;
+    }
+    if (light.is_bounded()) return truncated_shadow(box, L, light.radius, hull);
+    corners(box, hull.points);
+    for (size_t k = 0; k < 8; k++) hull.directions.push_back(hull.points[k] - L);
+    return true;
+}
+
+static AABB intersection(const AABB& a, const AABB& b) {
+    const Vec3f a_lo = a.get_min(), a_hi = a.get_max(), b_lo = b.get_min(), b_hi = b.get_max();
+    return AABB(Vec3f(std::max(a_lo.x, b_lo.x), std::max(a_lo.y, b_lo.y), std::max(a_lo.z, b_lo.z)),
+                Vec3f(std::min(a_hi.x, b_hi.x), std::min(a_hi.y, b_hi.y), std::min(a_hi.z, b_hi.z)));
+}
+
+// Parties du volume d'ombre où peut se trouver une surface : dans la boîte des objets bornés, l'ombre est
+// arrêtée au coin de cette boîte le plus éloigné de la lumière ; sur chaque plan, elle est réduite à la
+// projection de la boîte depuis la lumière. Les deux restent dans la sphère d'influence d'une lumière
+// bornée. Le volume entier est gardé quand il ne peut pas être réduit.
+static void clip_shadow(const Hull& shadow, const AABB& box, const Light& light, const Receivers& receivers,
+                        std::vector<Hull>& parts) {
+    if (shadow.points.empty() || !receivers.clippable) {
+        parts.push_back(shadow);
+        return;
+    }
+    const Vec3f L = light.position;
+    AABB reachable = receivers.bounds;
+    float reach = 0.f;
+    if (!receivers.bounds.is_empty()) {
+        std::vector<Vec3f> receiver_corners;
+        corners(receivers.bounds, receiver_corners);
+        for (const Vec3f& c : receiver_corners) {
+            Vec3f to_corner = c - L;
+            reach = std::max(reach, to_corner.norm());
+        }
+    }
+    AABB influence;
+    if (light.is_bounded()) {
+        const float r = light.radius;
+        influence = AABB(L - Vec3f(r, r, r), L + Vec3f(r, r, r));
+        reach = std::min(reach, r);
+        reachable = intersection(reachable, influence);
+    }
+    Hull truncated;
+    if (truncated_shadow(box, L, reach, truncated)) {
+        AABB extent;
+        for (const Vec3f& p : truncated.points) extent.expand(p);
+        const AABB clipped = intersection(extent, reachable);
+        if (!clipped.is_empty()) {
+            corners(clipped, truncated.bound);
+            parts.push_back(truncated);
+        }
+    }
+
+    // Sur un plan, l'ombre est l'enveloppe des projections des coins depuis la lumière, et de la boîte
+    // elle-même si elle traverse le plan. Elle n'est pas bornée si certains coins seulement se projettent
+    // sur le plan.
+    std::vector<Vec3f> box_corners;
+    corners(box, box_corners);
+    for (const PlaneEquation& plane : receivers.planes) {
+        Hull on_plane;
+        size_t hits = 0;
+        bool crosses = false;
+        for (const Vec3f& c : box_corners) {
+            const float denominator = plane.normal*(c - L);
+            const float t = (plane.distance - plane.normal*L) / denominator;
+            if (!(denominator != 0.f && t > 0.f)) continue;
+            hits++;
+            if (t > 1.f) on_plane.points.push_back(L + (c - L)*t);
+            else crosses = true;
+        }
+        if (crosses) on_plane.points.insert(on_plane.points.end(), box_corners.begin(), box_corners.end());
+        if (hits == 0) continue;
+        if (hits < box_corners.size()) {
+            parts.resize(0);
+            parts.push_back(shadow);
+            return;
+        }
+        if (light.is_bounded()) {
+            // Partie du plan dans la sphère d'influence, aplatie sur le plan s'il est perpendiculaire à un axe
+            Vec3f lo = influence.get_min(), hi = influence.get_max();
+            for (size_t k = 0; k < 3; k++) {
+                if (plane.normal[(k + 1) % 3] != 0.f || plane.normal[(k + 2) % 3] != 0.f) continue;
+                lo[k] = hi[k] = plane.distance / plane.normal[k];
+            }
+            corners(AABB(lo, hi), on_plane.bound);
+        }
+        parts.push_back(on_plane);
+    }
+}
+
+static Hull mirror(const Hull& hull, const PlaneEquation& plane) {
+    Hull image;
+    for (const Vec3f& p : hull.points) image.points.push_back(p - plane.normal*(2.f*(plane.normal*p - plane.distance)));
+    for (const Vec3f& d : hull.directions) image.directions.push_back(d - plane.normal*(2.f*(plane.normal*d)));
+    for (const Vec3f& p : hull.bound) image.bound.push_back(p - plane.normal*(2.f*(plane.normal*p - plane.distance)));
+    return image;
+}
+
+// Rectangle de l'écran, en pixels, qui contient l'image de l'enveloppe de points et de directions.
+// Faux si cette image n'est pas bornée : un point trop près ou derrière la caméra, une direction qui ne
+// s'en éloigne pas.
+static bool screen_bounds(const std::vector<Vec3f>& points, const std::vector<Vec3f>& directions,
+                          const RenderOptions& options, float rect[4]) {
+    const float width = options.width, height = options.height;
+    const float tan_half_fov = std::tan(options.fov/2.);
+    rect[0] = rect[1] = std::numeric_limits<float>::infinity();
+    rect[2] = rect[3] = -std::numeric_limits<float>::infinity();
+    // Pixel (i, j) dont le rayon primaire passe par la direction (x, y, -1), inverse de primary_ray_dir
+    auto add = [&](float x, float y) {
+        const float i = (x/(tan_half_fov*width/height) + 1.f)*width/2.f - 0.5f;
+        const float j = (1.f - y/tan_half_fov)*height/2.f - 0.5f;
+        rect[0] = std::min(rect[0], i);
+        rect[1] = std::min(rect[1], j);
+        rect[2] = std::max(rect[2], i);
+        rect[3] = std::max(rect[3], j);
+    };
+    for (const Vec3f& p : points) {
+        if (!(p.z < -NEAR_DEPTH)) return false;
+        add(p.x/-p.z, p.y/-p.z);
+    }
+    for (const Vec3f& d : directions) {
+        if (!(d.z < 0.f)) return false;
+        add(d.x/-d.z, d.y/-d.z);
+    }
+    return true;
+}
+
+// Partie de l'enveloppe des points devant la profondeur NEAR_DEPTH : les points de ce côté et les
+// intersections des segments qui traversent le plan z = -NEAR_DEPTH
+static std::vector<Vec3f> clip_near(const std::vector<Vec3f>& points) {
+    std::vector<Vec3f> clipped;
+    for (const Vec3f& p : points) {
+        if (!(p.z <= -NEAR_DEPTH)) continue;
+        clipped.push_back(p);
+        for (const Vec3f& q : points) {
+            if (q.z <= -NEAR_DEPTH) continue;
+            clipped.push_back(p + (q - p)*((-NEAR_DEPTH - p.z)/(q.z - p.z)));
+        }
+    }
+    return clipped;
+}
+
+// Marque les tuiles que recouvre l'image à l'écran de l'enveloppe, agrandie d'un pixel : l'intersection
+// des images de hull et de hull.bound, ou celle des deux qui est bornée. Faux si aucune ne l'est.
+// Avec clip, aucune surface n'est assez près de la caméra pour être vue en deçà de NEAR_DEPTH : une
+// enveloppe sans directions est coupée à cette profondeur.
+static bool mark_hull(const Hull& hull, bool clip, const RenderOptions& options, const TileScheduler& tiles,
+                      std::vector<char>& dirty) {
+    if (clip && hull.directions.empty()) {
+        Hull clipped;
+        clipped.points = clip_near(hull.points);
+        if (clipped.points.empty()) return true;
+        clipped.bound = clip_near(hull.bound);
+        return mark_hull(clipped, false, options, tiles, dirty);
+    }
+    float rect[4], bound[4];
+    const bool has_rect = screen_bounds(hull.points, hull.directions, options, rect);
+    const bool has_bound = !hull.bound.empty() && screen_bounds(hull.bound, {}, options, bound);
+    if (!has_rect && !has_bound) return false;
+    if (!has_rect) {
+        std::copy(bound, bound + 4, rect);
+    } else if (has_bound) {
+        rect[0] = std::max(rect[0], bound[0]);
+        rect[1] = std::max(rect[1], bound[1]);
+        rect[2] = std::min(rect[2], bound[2]);
+        rect[3] = std::min(rect[3], bound[3]);
+    }
+    const float width = options.width, height = options.height;
+    if (rect[0] > rect[2] || rect[1] > rect[3] || rect[2] < -1.f || rect[3] < -1.f || rect[0] > width || rect[1] > height) {
+        return true;
+    }
+    const int x0 = static_cast<int>(std::floor(std::max(rect[0], -1.f))) - 1;
+    const int y0 = static_cast<int>(std::floor(std::max(rect[1], -1.f))) - 1;
+    const int x1 = static_cast<int>(std::ceil(std::min(rect[2], width))) + 2;
+    const int y1 = static_cast<int>(std::ceil(std::min(rect[3], height))) + 2;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        const Tile& tile = tiles.get(t);
+        if (tile.x0 < x1 && tile.x1 > x0 && tile.y0 < y1 && tile.y1 > y0) dirty[t] = 1;
+    }
+    return true;
+}
+
+// Tuiles à recalculer quand la scène before devient after. Un pixel change si son rayon primaire traverse
+// la boîte d'un objet modifié (avant ou après), si le point qu'il voit est dans l'ombre portée de cette
+// boîte, ou si son rayon passe par un miroir ou un objet transparent : ces objets sont toujours recalculés,
+// ainsi que leurs reflets et ceux des objets modifiés dans un plan réfléchissant. Faux si toute l'image
+// doit être recalculée.
+static bool find_dirty_tiles(const Scene& before, const Scene& after, const RenderOptions& options,
+                             const TileScheduler& tiles, std::vector<Tile>& dirty) {
+    if (!same_lights(before.get_lights(), after.get_lights())) return false;
+    if (!same_materials(before.get_materials(), after.get_materials())) return false;
+
+    // Les objets sont appariés par leur description, quelle que soit leur place dans le fichier
+    std::map<std::vector<float>, size_t> unmatched;
+    std::vector<const Object*> changed;
+    for (const Object* object : before.get_objects()) {
+        std::vector<float> description;
+        describe_object(object, description);
+        unmatched[description]++;
+    }
+    std::map<std::vector<float>, size_t> kept;
+    for (const Object* object : after.get_objects()) {
+        std::vector<float> description;
+        describe_object(object, description);
+        auto it = unmatched.find(description);
+        if (it != unmatched.end() && it->second > 0) {
+            it->second--;
+            kept[description]++;
+        } else {
+            changed.push_back(object);
+        }
+    }
+    for (const Object* object : before.get_objects()) {
+        std::vector<float> description;
+        describe_object(object, description);
+        size_t& count = kept[description];
+        if (count > 0) count--;
+        else changed.push_back(object);
+    }
+    dirty.clear();
+    if (changed.empty()) return true;
+
+    Receivers receivers;
+    for (const Scene* scene : {&before, &after}) {
+        for (const Object* object : scene->get_objects()) {
+            if (object->is_bounded()) {
+                receivers.bounds.expand(object->get_bounds());
+            } else if (const Plane* plane = dynamic_cast<const Plane*>(object)) {
+                if (scene == &after) receivers.planes.push_back(plane_equation(plane));
+            } else {
+                receivers.clippable = false;
+            }
+        }
+    }
+    Vec3f lo = receivers.bounds.get_min(), hi = receivers.bounds.get_max();
+    for (const PlaneEquation& plane : receivers.planes) {
+        for (size_t k = 0; k < 3; k++) {
+            // Plan normal à l'axe k : x_k = distance / normal_k, la caméra (à l'origine) d'un côté
+            if (plane.normal[(k + 1) % 3] != 0.f || plane.normal[(k + 2) % 3] != 0.f) continue;
+            const float level = plane.distance / plane.normal[k];
+            if (level < 0.f) lo[k] = std::max(lo[k], level);
+            else hi[k] = std::min(hi[k], level);
+        }
+    }
+    receivers.bounds = AABB(lo, hi);
+
+    // Miroirs et objets transparents de la scène, et plan réfléchissant. Deux plans réfléchissants peuvent
+    // se renvoyer les rayons indéfiniment : l'image est alors recalculée entière.
+    const bool secondary = options.shading != ShadingModel::None;
+    std::vector<AABB> mirrors;
+    std::vector<PlaneEquation> mirror_planes;
+    for (const Object* object : after.get_objects()) {
+        std::vector<MaterialId> materials;
+        collect_materials(object, materials);
+        bool reflects = false, refracts = false;
+        for (MaterialId id : materials) {
+            const Vec4f albedo = after.get_materials().get(id).get_albedo();
+            reflects = reflects || (secondary && albedo[2] != 0.f);
+            refracts = refracts || (secondary && albedo[3] != 0.f);
+        }
+        if (!reflects && !refracts) continue;
+        if (object->is_bounded()) {
+            mirrors.push_back(object->get_bounds());
+            continue;
+        }
+        const Plane* plane = dynamic_cast<const Plane*>(object);
+        if (plane == nullptr || refracts) return false;
+        mirror_planes.push_back(plane_equation(plane));
+    }
+    if (mirror_planes.size() > 1) return false;
+
+    std::vector<char> marked(tiles.size(), 0);
+    // Les points visibles en deçà de NEAR_DEPTH sont à moins de NEAR_DEPTH*near_factor de la caméra
+    const float tan_half_fov = std::tan(options.fov/2.), aspect = float(options.width)/options.height;
+    const float near_factor = std::sqrt(1.f + tan_half_fov*tan_half_fov*(1.f + aspect*aspect));
+    bool clip = receivers.clippable;
+    for (const PlaneEquation& plane : receivers.planes) clip = clip && std::abs(plane.distance) > NEAR_DEPTH*near_factor;
+    if (!receivers.bounds.is_empty()) {
+        const Vec3f lo = receivers.bounds.get_min(), hi = receivers.bounds.get_max();
+        Vec3f nearest(std::min(std::max(0.f, lo.x), hi.x), std::min(std::max(0.f, lo.y), hi.y), std::min(std::max(0.f, lo.z), hi.z));
+        clip = clip && nearest.norm() > NEAR_DEPTH*near_factor;
+    }
+
+    auto mark = [&](const Hull& hull) {
+        if (!mark_hull(hull, clip, options, tiles, marked)) return false;
+        for (const PlaneEquation& plane : mirror_planes) {
+            if (!mark_hull(mirror(hull, plane), clip, options, tiles, marked)) return false;
+        }
+        return true;
+    };
+    for (const Object* object : changed) {
+        if (!object->is_bounded()) return false;
+        AABB box = object->get_bounds();
+        box.pad(BOUNDS_MARGIN);
+        Hull hull;
+        corners(box, hull.points);
+        if (!mark(hull)) return false;
+        for (const Light& light : after.get_lights()) {
+            Hull shadow;
+            if (!shadow_hull(box, light, shadow)) continue;
+            std::vector<Hull> parts;
+            clip_shadow(shadow, box, light, receivers, parts);
+            for (const Hull& part : parts) {
+                if (!mark(part)) return false;
+            }
+        }
+    }
+    for (const AABB& box : mirrors) {
+        Hull hull;
+        corners(box, hull.points);
+        if (!mark(hull)) return false;
+    }
+    for (size_t t = 0; t < tiles.size(); t++) {
+        if (marked[t]) dirty.push_back(tiles.get(t));
+    }
+    return true;
+}
+
+// Date et taille du fichier, comparées à chaque vérification. Un fichier absent (en cours d'écriture par
+// un éditeur) garde la date précédente.
+struct FileStamp {
+    std::filesystem::file_time_type time;
+    std::uintmax_t size = 0;
+
+    bool operator==(const FileStamp& other) const { return time == other.time && size == other.size; }
+};
+
+static FileStamp file_stamp(const std::string& filename, const FileStamp& previous) {
+    std::error_code error;
+    FileStamp stamp;
+    stamp.time = std::filesystem::last_write_time(filename, error);
+    if (error) return previous;
+    stamp.size = std::filesystem::file_size(filename, error);
+    if (error) return previous;
+    return stamp;
+}
+
+bool watch_scene(const std::string& filename, const SceneLoader& load, const RenderOptions& options, ImageWriter& writer) {
+    std::unique_ptr<Scene> scene(new Scene());
+    FileStamp stamp = file_stamp(filename, FileStamp());
+    if (!load(*scene)) return false;
+    scene->build();
+
+    TileScheduler tiles(options.width, options.height, options.tile_size, options.tile_order);
+    std::vector<Tile> all_tiles;
+    for (size_t t = 0; t < tiles.size(); t++) all_tiles.push_back(tiles.get(t));
+    const ImageFormat format = choose_image_format(options.output, options.format);
+    std::vector<Vec3f> framebuffer(static_cast<size_t>(options.width)*options.height);
+
+    double start = omp_get_wtime();
+    render_tiles(*scene, options, all_tiles, framebuffer);
+    writer.submit(options.output, format, options.width, options.height, std::vector<Vec3f>(framebuffer));
+    std::cout << "Rendu en " << omp_get_wtime() - start << " s ; surveillance de " << filename
+              << " (Ctrl-C pour arrêter)" << std::endl;
+
+    while (true) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        const FileStamp current = file_stamp(filename, stamp);
+        if (current == stamp) continue;
+        stamp = current;
+
+        start = omp_get_wtime();
+        std::unique_ptr<Scene> next(new Scene());
+        if (!load(*next)) {
+            std::cerr << "Scène ignorée, en attente de la prochaine modification de " << filename << std::endl;
+            continue;
+        }
+        next->build();
+        std::vector<Tile> dirty;
+        if (!find_dirty_tiles(*scene, *next, options, tiles, dirty)) dirty = all_tiles;
+        scene.swap(next);
+        if (dirty.empty()) {
+            std::cout << "Aucun changement visible" << std::endl;
+            continue;
+        }
+        render_tiles(*scene, options, dirty, framebuffer);
+        writer.submit(options.output, format, options.width, options.height, std::vector<Vec3f>(framebuffer));
+        std::cout << dirty.size() << " tuiles sur " << tiles.size() << " recalculées en " << omp_get_wtime() - start
+                  << " s" << std::endl;
+    }
+}